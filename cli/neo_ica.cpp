@@ -0,0 +1,151 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "neo_ica/ica.h"
+#include "neo_ica/tools/mapped_file.hpp"
+
+static const char * USAGE_STR =
+"Usage : neo_ica <input> --channels NC [options]\n"
+"\n"
+"Runs ICA on a raw binary file, mapped read-only.\n"
+"\n"
+"  --channels NC        number of channels\n"
+"  --samples NF         number of samples (default : deduced from the file size)\n"
+"  --dtype TYPE         float32 or float64 (default : float32)\n"
+"  --layout LAYOUT      sample (one sample after the other, as in EEGLAB .fdt files) or channel (default : sample)\n"
+"  --offset BYTES       size of a header to skip (default : 0)\n"
+"  --weights PATH       output weights, K*K row-major in the input dtype (default : <input>.weights)\n"
+"  --sphere PATH        output sphere, K*NC row-major in the input dtype (default : <input>.sphere)\n"
+"  --solver NAME        newton, lbfgs or orthogonal (default : newton)\n"
+"  --pca K              number of principal components to keep (default : all)\n"
+"  --block-size N       samples per minibatch block, instead of shuffling the data (default : 0)\n"
+"  --scratch PATH       keeps the whitened data in a temporary file at PATH instead of in memory\n"
+"  --storage TYPE       full, int16 or bfloat16 : precision of the whitened data kept in memory (default : full)\n"
+"  --mixed 0|1          float64 only : single precision data and intermediates (default : 0)\n"
+"  --extended 0|1       extended infomax (default : 1)\n"
+"  --extblocks K        re-estimate the extended signs every K iterations, 0 : only at convergence (default : 10)\n"
+"  --levels L           lbfgs and orthogonal only : coarse-to-fine levels, each on 4 times more samples (default : 1)\n"
+"  --iter N             maximum number of iterations\n"
+"  --tol TOL            tolerance on the change of weights\n"
+"  --verbose N          verbosity level\n";
+
+struct arguments{
+    arguments() : NC(0), NF(0), dtype("float32"), layout(neo_ica::SAMPLE_MAJOR), offset(0){ }
+    std::string input;
+    int64_t NC;
+    int64_t NF;
+    std::string dtype;
+    neo_ica::layout_type layout;
+    size_t offset;
+    std::string weights;
+    std::string sphere;
+    neo_ica::options opts;
+};
+
+static bool parse(int argc, char* argv[], arguments & args){
+    for(int i = 1 ; i < argc ; ++i){
+        std::string key = argv[i];
+        if(key.compare(0, 2, "--")!=0){
+            if(!args.input.empty())
+                return false;
+            args.input = key;
+            continue;
+        }
+        if(i+1 >= argc)
+            return false;
+        char const * value = argv[++i];
+        if(key=="--channels") args.NC = std::atol(value);
+        else if(key=="--samples") args.NF = std::atol(value);
+        else if(key=="--dtype") args.dtype = value;
+        else if(key=="--offset") args.offset = std::atol(value);
+        else if(key=="--weights") args.weights = value;
+        else if(key=="--sphere") args.sphere = value;
+        else if(key=="--pca") args.opts.pca_components = std::atol(value);
+        else if(key=="--block-size") args.opts.block_size = std::atol(value);
+        else if(key=="--scratch") args.opts.scratch = value;
+        else if(key=="--extended") args.opts.extended = std::atoi(value)!=0;
+        else if(key=="--extblocks") args.opts.extblocks = std::atol(value);
+        else if(key=="--levels") args.opts.levels = std::atol(value);
+        else if(key=="--mixed") args.opts.mixed_precision = std::atoi(value)!=0;
+        else if(key=="--iter") args.opts.iter = std::atol(value);
+        else if(key=="--tol") args.opts.tol = std::atof(value);
+        else if(key=="--verbose") args.opts.verbose = std::atoi(value);
+        else if(key=="--layout"){
+            if(std::strcmp(value, "sample")==0) args.layout = neo_ica::SAMPLE_MAJOR;
+            else if(std::strcmp(value, "channel")==0) args.layout = neo_ica::CHANNEL_MAJOR;
+            else return false;
+        }
+        else if(key=="--storage"){
+            if(std::strcmp(value, "full")==0) args.opts.storage = neo_ica::STORE_FULL;
+            else if(std::strcmp(value, "int16")==0) args.opts.storage = neo_ica::STORE_INT16;
+            else if(std::strcmp(value, "bfloat16")==0) args.opts.storage = neo_ica::STORE_BFLOAT16;
+            else return false;
+        }
+        else if(key=="--solver"){
+            if(std::strcmp(value, "lbfgs")==0) args.opts.solver = neo_ica::RELATIVE_LBFGS;
+            else if(std::strcmp(value, "orthogonal")==0) args.opts.solver = neo_ica::ORTHOGONAL_LBFGS;
+            else if(std::strcmp(value, "newton")==0) args.opts.solver = neo_ica::NEWTON_CG;
+            else return false;
+        }
+        else
+            return false;
+    }
+    if(args.weights.empty()) args.weights = args.input + ".weights";
+    if(args.sphere.empty()) args.sphere = args.input + ".sphere";
+    return !args.input.empty() && args.NC > 0 && (args.dtype=="float32" || args.dtype=="float64");
+}
+
+template<class T>
+static void write(std::string const & path, std::vector<T> const & x){
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out.write((char const *)x.data(), sizeof(T)*x.size());
+    if(!out)
+        throw neo_ica::exception("Cannot write " + path);
+}
+
+template<class T>
+static void run(arguments const & args){
+    int64_t NF = args.NF;
+    if(NF==0){
+        neo_ica::tools::mapped_file file(args.input);
+        NF = (file.size() - std::min(file.size(), args.offset))/(sizeof(T)*args.NC);
+    }
+    int64_t NK = (args.opts.pca_components > 0)?std::min<int64_t>(args.opts.pca_components, args.NC):args.NC;
+    std::vector<T> weights(NK*NK);
+    std::vector<T> sphere(NK*args.NC);
+    neo_ica::ica<T>(args.input, weights.data(), sphere.data(), args.NC, NF, args.layout, args.opts, args.offset);
+    write(args.weights, weights);
+    write(args.sphere, sphere);
+}
+
+int main(int argc, char* argv[]){
+    arguments args;
+    if(!parse(argc, argv, args)){
+        std::cerr << USAGE_STR;
+        return EXIT_FAILURE;
+    }
+    try{
+        if(args.dtype=="float32")
+            run<float>(args);
+        else
+            run<double>(args);
+    }
+    catch(std::exception const & e){
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
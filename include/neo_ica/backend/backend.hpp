@@ -18,7 +18,8 @@
 
 namespace neo_ica{
 
-static std::ptrdiff_t dummy_info;
+//Per thread, since independent problems may be solved concurrently
+static thread_local std::ptrdiff_t dummy_info;
 
 static const char Trans = 'T';
 static const char NoTrans = 'N';
@@ -42,6 +43,8 @@ struct backend<float>{
 
     static void getrf(size_t m, size_t n, ptr_type a, size_t lda, size_t* ipiv)
     {   sgetrf(&m,&n,a,&lda,(size_t*)ipiv,&dummy_info);    }
+    static void getrs(char trans, size_t n, size_t nrhs, cst_ptr_type A, size_t lda, size_t* ipiv, ptr_type B, size_t ldb)
+    {   sgetrs(&trans,&n,&nrhs,(ptr_type)A,&lda,ipiv,B,&ldb,&dummy_info);    }
     static void getri(size_t n, ptr_type A, size_t lda, size_t* ipiv)
     {
         size_t lwork = -1;
@@ -55,6 +58,37 @@ struct backend<float>{
     }
     static void gemm(char TransA, char TransB, size_t M, size_t N, size_t K , ScalarType alpha, cst_ptr_type A, size_t lda, cst_ptr_type B, size_t ldb, ScalarType beta, ptr_type C, size_t ldc)
     {   sgemm(&TransA,&TransB,&M,&N,&K,&alpha,(ptr_type)A,&lda,(ptr_type)B,&ldb,&beta,C,&ldc); }
+    static void syrk(char uplo, char trans, size_t n, size_t k, ScalarType alpha, cst_ptr_type A, size_t lda, ScalarType beta, ptr_type C, size_t ldc)
+    {   ssyrk(&uplo,&trans,&n,&k,&alpha,(ptr_type)A,&lda,&beta,C,&ldc); }
+    static void geqrf(size_t m, size_t n, ScalarType* a, size_t lda, ScalarType* tau)
+    {
+        size_t lwork = -1;
+        ScalarType* work = new ScalarType;
+        sgeqrf(&m,&n,a,&lda,tau,work,&lwork,&dummy_info);
+        lwork = (size_t) work[0];
+        delete work;
+        work = new ScalarType[lwork];
+        sgeqrf(&m,&n,a,&lda,tau,work,&lwork,&dummy_info);
+        delete[] work;
+    }
+    static void orgqr(size_t m, size_t n, size_t k, ScalarType* a, size_t lda, ScalarType const * tau)
+    {
+        size_t lwork = -1;
+        ScalarType* work = new ScalarType;
+        sorgqr(&m,&n,&k,a,&lda,(ptr_type)tau,work,&lwork,&dummy_info);
+        lwork = (size_t) work[0];
+        delete work;
+        work = new ScalarType[lwork];
+        sorgqr(&m,&n,&k,a,&lda,(ptr_type)tau,work,&lwork,&dummy_info);
+        delete[] work;
+    }
+    static void syevd(char jobz, char uplo, size_t n, ScalarType* a, size_t lda, ScalarType* w, ScalarType* work, size_t lwork, size_t* iwork, size_t liwork)
+    {   ssyevd(&jobz,&uplo,&n,a,&lda,w,work,&lwork,iwork,&liwork,&dummy_info); }
+    static void syevr(char jobz, char range, char uplo, size_t n, ScalarType* a, size_t lda, size_t il, size_t iu, size_t* m, ScalarType* w, ScalarType* z, size_t ldz, size_t* isuppz, ScalarType* work, size_t lwork, size_t* iwork, size_t liwork)
+    {
+        ScalarType vl = 0, vu = 0, abstol = 0;
+        ssyevr(&jobz,&range,&uplo,&n,a,&lda,&vl,&vu,&il,&iu,&abstol,m,w,z,&ldz,isuppz,work,&lwork,iwork,&liwork,&dummy_info);
+    }
     static void syev(char jobz, char uplo, size_t n,  ScalarType* a, size_t lda, ScalarType* w )
     {
         size_t lwork = -1;
@@ -78,6 +112,8 @@ struct backend<double>{
 
     static void getrf(size_t m, size_t n, ptr_type a, size_t lda, size_t* ipiv)
     {   dgetrf(&m,&n,a,&lda,(size_t*)ipiv,&dummy_info);    }
+    static void getrs(char trans, size_t n, size_t nrhs, cst_ptr_type A, size_t lda, size_t* ipiv, ptr_type B, size_t ldb)
+    {   dgetrs(&trans,&n,&nrhs,(ptr_type)A,&lda,ipiv,B,&ldb,&dummy_info);    }
     static void getri(size_t n, ptr_type A, size_t lda, size_t* ipiv)
     {
         size_t lwork = -1;
@@ -91,6 +127,37 @@ struct backend<double>{
     }
     static void gemm(char TransA, char TransB, size_t M, size_t N, size_t K , ScalarType alpha, cst_ptr_type A, size_t lda, cst_ptr_type B, size_t ldb, ScalarType beta, ptr_type C, size_t ldc)
     {   dgemm(&TransA,&TransB,&M,&N,&K,&alpha,(ptr_type)A,&lda,(ptr_type)B,&ldb,&beta,C,&ldc); }
+    static void syrk(char uplo, char trans, size_t n, size_t k, ScalarType alpha, cst_ptr_type A, size_t lda, ScalarType beta, ptr_type C, size_t ldc)
+    {   dsyrk(&uplo,&trans,&n,&k,&alpha,(ptr_type)A,&lda,&beta,C,&ldc); }
+    static void geqrf(size_t m, size_t n, ScalarType* a, size_t lda, ScalarType* tau)
+    {
+        size_t lwork = -1;
+        ScalarType* work = new ScalarType;
+        dgeqrf(&m,&n,a,&lda,tau,work,&lwork,&dummy_info);
+        lwork = (size_t) work[0];
+        delete work;
+        work = new ScalarType[lwork];
+        dgeqrf(&m,&n,a,&lda,tau,work,&lwork,&dummy_info);
+        delete[] work;
+    }
+    static void orgqr(size_t m, size_t n, size_t k, ScalarType* a, size_t lda, ScalarType const * tau)
+    {
+        size_t lwork = -1;
+        ScalarType* work = new ScalarType;
+        dorgqr(&m,&n,&k,a,&lda,(ptr_type)tau,work,&lwork,&dummy_info);
+        lwork = (size_t) work[0];
+        delete work;
+        work = new ScalarType[lwork];
+        dorgqr(&m,&n,&k,a,&lda,(ptr_type)tau,work,&lwork,&dummy_info);
+        delete[] work;
+    }
+    static void syevd(char jobz, char uplo, size_t n, ScalarType* a, size_t lda, ScalarType* w, ScalarType* work, size_t lwork, size_t* iwork, size_t liwork)
+    {   dsyevd(&jobz,&uplo,&n,a,&lda,w,work,&lwork,iwork,&liwork,&dummy_info); }
+    static void syevr(char jobz, char range, char uplo, size_t n, ScalarType* a, size_t lda, size_t il, size_t iu, size_t* m, ScalarType* w, ScalarType* z, size_t ldz, size_t* isuppz, ScalarType* work, size_t lwork, size_t* iwork, size_t liwork)
+    {
+        ScalarType vl = 0, vu = 0, abstol = 0;
+        dsyevr(&jobz,&range,&uplo,&n,a,&lda,&vl,&vu,&il,&iu,&abstol,m,w,z,&ldz,isuppz,work,&lwork,iwork,&liwork,&dummy_info);
+    }
     static void syev(char jobz, char uplo, size_t n,  ScalarType* a, size_t lda, ScalarType* w )
     {
         size_t lwork = -1;
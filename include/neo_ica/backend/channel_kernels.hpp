@@ -0,0 +1,288 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef NEO_ICA_BACKEND_CHANNEL_KERNELS_HPP_
+#define NEO_ICA_BACKEND_CHANNEL_KERNELS_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "neo_ica/backend/backend.hpp"
+#include "neo_ica/backend/lu.hpp"
+
+namespace neo_ica
+{
+
+/* Kernels for a compile-time number of channels NC
+ *
+ * The loops over the channels are unrolled and the NC*NC matrices live on the stack, so that the projections keep the
+ * weights in registers and vectorize along the samples. Matrices are column-major, chunks are X[c*ld + f]. */
+namespace fixed_size
+{
+
+/* Z = X*W, for a chunk of len samples */
+template<int NC, class T>
+void project(int64_t len, T const * X, int64_t ldx, T const * W, T * Z, int64_t ldz){
+    for(int c = 0 ; c < NC ; ++c){
+        T w[NC];
+        for(int k = 0 ; k < NC ; ++k)
+            w[k] = W[k + c*NC];
+        T * z = Z + c*ldz;
+        for(int64_t f = 0 ; f < len ; ++f){
+            T acc = 0;
+            for(int k = 0 ; k < NC ; ++k)
+                acc += w[k]*X[k*ldx + f];
+            z[f] = acc;
+        }
+    }
+}
+
+/* R = alpha*X'*Y + beta*R, for chunks of len samples */
+template<int NC, class T>
+void cross(int64_t len, T alpha, T const * X, int64_t ldx, T const * Y, int64_t ldy, T beta, T * R){
+    for(int j = 0 ; j < NC ; ++j)
+        for(int i = 0 ; i < NC ; ++i){
+            T const * x = X + i*ldx;
+            T const * y = Y + j*ldy;
+            T acc[4] = {0, 0, 0, 0};
+            int64_t f = 0;
+            for( ; f + 4 <= len ; f += 4)
+                for(int u = 0 ; u < 4 ; ++u)
+                    acc[u] += x[f+u]*y[f+u];
+            for( ; f < len ; ++f)
+                acc[0] += x[f]*y[f];
+            T dot = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+            R[i + j*NC] = (beta==0)?alpha*dot:alpha*dot + beta*R[i + j*NC];
+        }
+}
+
+/* C = alpha*op(A)*op(B) + beta*C. C may alias A or B */
+template<int NC, class T>
+void gemm(char transA, char transB, T alpha, T const * A, T const * B, T beta, T * C){
+    T a[NC][NC];
+    T b[NC][NC];
+    for(int i = 0 ; i < NC ; ++i)
+        for(int k = 0 ; k < NC ; ++k){
+            a[i][k] = (transA==NoTrans)?A[i + k*NC]:A[k + i*NC];
+            b[i][k] = (transB==NoTrans)?B[i + k*NC]:B[k + i*NC];
+        }
+    for(int j = 0 ; j < NC ; ++j)
+        for(int i = 0 ; i < NC ; ++i){
+            T acc = 0;
+            for(int k = 0 ; k < NC ; ++k)
+                acc += a[i][k]*b[k][j];
+            C[i + j*NC] = (beta==0)?alpha*acc:alpha*acc + beta*C[i + j*NC];
+        }
+}
+
+/* A = inv(A), by Gauss-Jordan elimination with partial pivoting. Returns log(abs(det(A))) */
+template<int NC, class T>
+T inverse(T * A){
+    T m[NC][NC];
+    T inv[NC][NC];
+    for(int i = 0 ; i < NC ; ++i)
+        for(int j = 0 ; j < NC ; ++j){
+            m[i][j] = A[i + j*NC];
+            inv[i][j] = (i==j)?1:0;
+        }
+    T logabsdet = 0;
+    for(int k = 0 ; k < NC ; ++k){
+        int p = k;
+        for(int i = k + 1 ; i < NC ; ++i)
+            if(std::abs(m[i][k]) > std::abs(m[p][k]))
+                p = i;
+        for(int j = 0 ; j < NC ; ++j){
+            std::swap(m[k][j], m[p][j]);
+            std::swap(inv[k][j], inv[p][j]);
+        }
+        //The pivots are the diagonal of U in the LU decomposition with the same pivoting
+        T pivot = m[k][k];
+        logabsdet += std::log(std::abs(pivot));
+        T scale = 1/pivot;
+        for(int j = 0 ; j < NC ; ++j){
+            m[k][j] *= scale;
+            inv[k][j] *= scale;
+        }
+        for(int i = 0 ; i < NC ; ++i){
+            if(i==k)
+                continue;
+            T factor = m[i][k];
+            for(int j = 0 ; j < NC ; ++j){
+                m[i][j] -= factor*m[k][j];
+                inv[i][j] -= factor*inv[k][j];
+            }
+        }
+    }
+    for(int i = 0 ; i < NC ; ++i)
+        for(int j = 0 ; j < NC ; ++j)
+            A[i + j*NC] = inv[i][j];
+    return logabsdet;
+}
+
+/* log(abs(det(A))), by LU decomposition with partial pivoting */
+template<int NC, class T>
+T logabsdet(T const * A){
+    T m[NC][NC];
+    for(int i = 0 ; i < NC ; ++i)
+        for(int j = 0 ; j < NC ; ++j)
+            m[i][j] = A[i + j*NC];
+    T res = 0;
+    for(int k = 0 ; k < NC ; ++k){
+        int p = k;
+        for(int i = k + 1 ; i < NC ; ++i)
+            if(std::abs(m[i][k]) > std::abs(m[p][k]))
+                p = i;
+        for(int j = k ; j < NC ; ++j)
+            std::swap(m[k][j], m[p][j]);
+        res += std::log(std::abs(m[k][k]));
+        for(int i = k + 1 ; i < NC ; ++i){
+            T factor = m[i][k]/m[k][k];
+            for(int j = k + 1 ; j < NC ; ++j)
+                m[i][j] -= factor*m[k][j];
+        }
+    }
+    return res;
+}
+
+}
+
+/* Operations of the objectives on NC*NC matrices and on chunks of NC channels
+ *
+ * For NC <= max_channels, the fixed_size kernels are selected once, at construction. Otherwise, the products go
+ * through BLAS, and the factorizations through native_lu up to native_lu<T>::max_size channels, LAPACK beyond. The
+ * cross products of more than 4 channels always use BLAS, which is faster there. */
+template<class T>
+class channel_kernels{
+    typedef void (*project_type)(int64_t, T const *, int64_t, T const *, T *, int64_t);
+    typedef void (*cross_type)(int64_t, T, T const *, int64_t, T const *, int64_t, T, T *);
+    typedef void (*gemm_type)(char, char, T, T const *, T const *, T, T *);
+    typedef T (*inverse_type)(T *);
+    typedef T (*logabsdet_type)(T const *);
+    typedef native_lu<T> lu;
+
+    template<int NC>
+    void select(){
+        project_ = &fixed_size::project<NC, T>;
+        cross_ = (NC <= 4)?&fixed_size::cross<NC, T>:NULL;
+        gemm_ = &fixed_size::gemm<NC, T>;
+        inverse_ = &fixed_size::inverse<NC, T>;
+        logabsdet_ = &fixed_size::logabsdet<NC, T>;
+    }
+
+public:
+    static const int64_t max_channels = 8;
+
+    channel_kernels(int64_t NC) : NC_(NC), ipiv_(NC + 1), lu_pivots_(NC + 1), lu_work_(NC + 1), project_(NULL), cross_(NULL), gemm_(NULL), inverse_(NULL), logabsdet_(NULL){
+        switch(NC){
+            case 1: select<1>(); break;
+            case 2: select<2>(); break;
+            case 3: select<3>(); break;
+            case 4: select<4>(); break;
+            case 5: select<5>(); break;
+            case 6: select<6>(); break;
+            case 7: select<7>(); break;
+            case 8: select<8>(); break;
+            default: break;
+        }
+    }
+
+    /* Z = X*W, for a chunk of len samples */
+    void project(int64_t len, T const * X, int64_t ldx, T const * W, T * Z, int64_t ldz) const{
+        if(project_)
+            project_(len, X, ldx, W, Z, ldz);
+        else
+            backend<T>::gemm(NoTrans,NoTrans,len,NC_,NC_,1,X,ldx,W,NC_,0,Z,ldz);
+    }
+
+    /* R = alpha*X'*Y + beta*R, for chunks of len samples */
+    void cross(int64_t len, T alpha, T const * X, int64_t ldx, T const * Y, int64_t ldy, T beta, T * R) const{
+        if(cross_)
+            cross_(len, alpha, X, ldx, Y, ldy, beta, R);
+        else
+            backend<T>::gemm(Trans,NoTrans,NC_,NC_,len,alpha,X,ldx,Y,ldy,beta,R,NC_);
+    }
+
+    /* C = alpha*op(A)*op(B) + beta*C, for NC*NC matrices. C must not alias A or B */
+    void gemm(char transA, char transB, T alpha, T const * A, T const * B, T beta, T * C) const{
+        if(gemm_)
+            gemm_(transA, transB, alpha, A, B, beta, C);
+        else
+            backend<T>::gemm(transA,transB,NC_,NC_,NC_,alpha,A,NC_,B,NC_,beta,C,NC_);
+    }
+
+    /* A = inv(A). Returns log(abs(det(A))) */
+    T inverse(T * A) const{
+        if(inverse_)
+            return inverse_(A);
+        if(NC_ <= lu::max_size){
+            lu::getrf(NC_,A,NC_,lu_pivots_.data());
+            T res = lu::logabsdet(NC_,A,NC_);
+            lu::getri(NC_,A,NC_,lu_pivots_.data(),lu_work_.data());
+            return res;
+        }
+        backend<T>::getrf(NC_,NC_,A,NC_,ipiv_.data());
+        T res = diagonal_logabsdet(A);
+        backend<T>::getri(NC_,A,NC_,ipiv_.data());
+        return res;
+    }
+
+    /* log(abs(det(A))). A is overwritten */
+    T logabsdet(T * A) const{
+        if(logabsdet_)
+            return logabsdet_(A);
+        if(NC_ <= lu::max_size){
+            lu::getrf(NC_,A,NC_,lu_pivots_.data());
+            return lu::logabsdet(NC_,A,NC_);
+        }
+        backend<T>::getrf(NC_,NC_,A,NC_,ipiv_.data());
+        return diagonal_logabsdet(A);
+    }
+
+    /* B = inv(A)*B. A is overwritten */
+    void solve(T * A, T * B) const{
+        if(inverse_){
+            T tmp[max_channels*max_channels];
+            inverse_(A);
+            gemm_(NoTrans, NoTrans, 1, A, B, 0, tmp);
+            std::copy(tmp, tmp + NC_*NC_, B);
+        }
+        else if(NC_ <= lu::max_size){
+            lu::getrf(NC_,A,NC_,lu_pivots_.data());
+            lu::getrs(NC_,NC_,A,NC_,lu_pivots_.data(),B,NC_);
+        }
+        else{
+            backend<T>::getrf(NC_,NC_,A,NC_,ipiv_.data());
+            backend<T>::getrs(NoTrans,NC_,NC_,A,NC_,ipiv_.data(),B,NC_);
+        }
+    }
+
+private:
+    T diagonal_logabsdet(T const * LU) const{
+        T res = 0;
+        for(int64_t i = 0 ; i < NC_ ; ++i)
+            res += std::log(std::abs(LU[i*(NC_+1)]));
+        return res;
+    }
+
+    int64_t NC_;
+    mutable std::vector<typename backend<T>::size_t> ipiv_;
+    mutable std::vector<typename lu::size_t> lu_pivots_;
+    mutable std::vector<T> lu_work_;
+    project_type project_;
+    cross_type cross_;
+    gemm_type gemm_;
+    inverse_type inverse_;
+    logabsdet_type logabsdet_;
+};
+
+}
+
+#endif
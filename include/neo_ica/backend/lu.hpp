@@ -0,0 +1,149 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef NEO_ICA_BACKEND_LU_HPP_
+#define NEO_ICA_BACKEND_LU_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace neo_ica
+{
+
+/* LU decomposition with partial pivoting, inverse, solve and log-determinant of small column-major matrices
+ *
+ * Same conventions as LAPACK's getrf, getri and getrs, except that the pivots are 0-based, and that getri takes its
+ * workspace of n elements from the caller : there is no workspace query and no allocation. The innermost loops all
+ * run down contiguous columns, where they vectorize. Meant for the NC*NC matrices of the objectives, up to
+ * max_size rows, beyond which LAPACK's blocked routines are faster. */
+template<class T>
+struct native_lu{
+    typedef std::ptrdiff_t size_t;
+
+    static const int64_t max_size = 64;
+    static const int64_t block = 16;
+
+    /* A = P*L*U. The columns are factored by panels of block columns, and each trailing column receives all the
+     * updates of a panel at once, while it stays in cache */
+    static void getrf(int64_t n, T * A, int64_t lda, size_t * ipiv){
+        for(int64_t k0 = 0 ; k0 < n ; k0 += block){
+            int64_t k1 = std::min(k0 + block, n);
+            for(int64_t k = k0 ; k < k1 ; ++k){
+                T * ak = A + k*lda;
+                int64_t p = k;
+                for(int64_t i = k + 1 ; i < n ; ++i)
+                    if(std::abs(ak[i]) > std::abs(ak[p]))
+                        p = i;
+                ipiv[k] = p;
+                if(p != k)
+                    for(int64_t j = 0 ; j < n ; ++j)
+                        std::swap(A[k + j*lda], A[p + j*lda]);
+                T scale = 1/ak[k];
+                for(int64_t i = k + 1 ; i < n ; ++i)
+                    ak[i] *= scale;
+                for(int64_t j = k + 1 ; j < k1 ; ++j)
+                    axpy(n - k - 1, -A[k + j*lda], ak + k + 1, A + k + 1 + j*lda);
+            }
+            //U12 = inv(L11)*A12 and A22 = A22 - L21*U12, one column at a time
+            for(int64_t j = k1 ; j < n ; ++j){
+                T * aj = A + j*lda;
+                int64_t k = k0;
+                for( ; k + 4 <= k1 ; k += 4){
+                    //Rows k+1 to k+3 first, then the rest in one pass
+                    for(int64_t q = k ; q < k + 3 ; ++q)
+                        for(int64_t i = q + 1 ; i < k + 4 ; ++i)
+                            aj[i] -= aj[q]*A[i + q*lda];
+                    axpy4(n - k - 4, -aj[k], -aj[k+1], -aj[k+2], -aj[k+3], A + k + 4 + k*lda, lda, aj + k + 4);
+                }
+                for( ; k < k1 ; ++k)
+                    axpy(n - k - 1, -aj[k], A + k + 1 + k*lda, aj + k + 1);
+            }
+        }
+    }
+
+    /* A = inv(A), from the output of getrf */
+    static void getri(int64_t n, T * A, int64_t lda, size_t const * ipiv, T * work){
+        //inv(U), column by column
+        for(int64_t j = 0 ; j < n ; ++j){
+            T * aj = A + j*lda;
+            aj[j] = 1/aj[j];
+            T ajj = -aj[j];
+            //aj(0:j) = inv(U)(0:j,0:j)*aj(0:j)
+            for(int64_t k = 0 ; k < j ; ++k){
+                T temp = aj[k];
+                axpy(k, temp, A + k*lda, aj);
+                aj[k] = temp*A[k + k*lda];
+            }
+            for(int64_t i = 0 ; i < j ; ++i)
+                aj[i] *= ajj;
+        }
+        //inv(A)*L = inv(U)
+        for(int64_t j = n - 1 ; j >= 0 ; --j){
+            T * aj = A + j*lda;
+            for(int64_t i = j + 1 ; i < n ; ++i){
+                work[i] = aj[i];
+                aj[i] = 0;
+            }
+            int64_t i = j + 1;
+            for( ; i + 4 <= n ; i += 4)
+                axpy4(n, -work[i], -work[i+1], -work[i+2], -work[i+3], A + i*lda, lda, aj);
+            for( ; i < n ; ++i)
+                axpy(n, -work[i], A + i*lda, aj);
+        }
+        //inv(A) = inv(A)*P
+        for(int64_t j = n - 2 ; j >= 0 ; --j)
+            if(ipiv[j] != j)
+                std::swap_ranges(A + j*lda, A + j*lda + n, A + ipiv[j]*lda);
+    }
+
+    /* B = inv(A)*B, from the output of getrf */
+    static void getrs(int64_t n, int64_t nrhs, T const * A, int64_t lda, size_t const * ipiv, T * B, int64_t ldb){
+        for(int64_t r = 0 ; r < nrhs ; ++r){
+            T * b = B + r*ldb;
+            for(int64_t k = 0 ; k < n ; ++k)
+                std::swap(b[k], b[ipiv[k]]);
+            for(int64_t k = 0 ; k < n ; ++k)
+                axpy(n - k - 1, -b[k], A + k + 1 + k*lda, b + k + 1);
+            for(int64_t k = n - 1 ; k >= 0 ; --k){
+                b[k] /= A[k + k*lda];
+                axpy(k, -b[k], A + k*lda, b);
+            }
+        }
+    }
+
+    /* log(abs(det(A))), from the output of getrf */
+    static T logabsdet(int64_t n, T const * LU, int64_t lda){
+        T res = 0;
+        for(int64_t i = 0 ; i < n ; ++i)
+            res += std::log(std::abs(LU[i*(lda+1)]));
+        return res;
+    }
+
+private:
+    static void axpy(int64_t n, T alpha, T const * x, T * y){
+        for(int64_t i = 0 ; i < n ; ++i)
+            y[i] += alpha*x[i];
+    }
+
+    //y = y + a0*x(:,0) + a1*x(:,1) + a2*x(:,2) + a3*x(:,3), with one pass over y
+    static void axpy4(int64_t n, T a0, T a1, T a2, T a3, T const * x, int64_t ldx, T * y){
+        T const * x0 = x;
+        T const * x1 = x + ldx;
+        T const * x2 = x + 2*ldx;
+        T const * x3 = x + 3*ldx;
+        for(int64_t i = 0 ; i < n ; ++i)
+            y[i] += (a0*x0[i] + a1*x1[i]) + (a2*x2[i] + a3*x3[i]);
+    }
+};
+
+}
+
+#endif
@@ -23,10 +23,12 @@ namespace neo_ica{
         inline static T logp(T z, T k);\
         inline static T phi(T z, T k);\
         inline static T dphi(T z, T k);\
+        inline static T phi_dphi(T z, T k, T & dphi);\
 \
         inline static __m128 logp(__m128 const &  z, __m128 const &  k);\
         inline static __m128 phi(__m128 const &  z, __m128 const &  k);\
         inline static __m128 dphi(__m128 const & z, __m128 const &  k);\
+        inline static __m128 phi_dphi(__m128 const & z, __m128 const &  k, __m128 & dphi);\
     }
 
 DECLARE_NONLINEARITY(infomax);
@@ -39,6 +41,8 @@ public:
     virtual void mu(int64_t offset, int64_t sample_size, T * z1, T* signs, T * mu) const = 0;
     virtual void phi(int64_t offset, int64_t sample_size, T * z1, T* signs, T* phi) const = 0;
     virtual void dphi(int64_t offset, int64_t sample_size, T * z1, T* signs, T* dphi) const = 0;
+    //Also computes the per-channel means of dphi(z) and z^2 in the same sweep
+    virtual void phi(int64_t offset, int64_t sample_size, T * z1, T* signs, T* phi, T* dphi_mean, T* zsq_mean) const = 0;
 
 protected:
     int64_t NC_;
@@ -55,16 +59,19 @@ private:
     void mu_fb(int64_t offset, int64_t sample_size, T * z1, T* signs, T * mu) const;
     void phi_fb(int64_t offset, int64_t sample_size, T * z1, T* signs, T* phi) const;
     void dphi_fb(int64_t offset, int64_t sample_size, T * z1, T* signs, T* dphi) const;
+    void phi_stats_fb(int64_t offset, int64_t sample_size, T * z1, T* signs, T* phi, T* dphi_mean, T* zsq_mean) const;
     //SSE3
     void mu_sse3(int64_t offset, int64_t sample_size, T * z1, T* signs, T * mu) const;
     void phi_sse3(int64_t offset, int64_t sample_size, T * z1, T* signs, T* phi) const;
     void dphi_sse3(int64_t offset, int64_t sample_size, T * z1, T* signs, T* dphi) const;
+    void phi_stats_sse3(int64_t offset, int64_t sample_size, T * z1, T* signs, T* phi, T* dphi_mean, T* zsq_mean) const;
 
 public:
     dist(int64_t NC, int64_t NF) : dist_base<T>(NC, NF){}
     void mu(int64_t offset, int64_t sample_size, T * z1, T* signs, T * mu) const;
     void phi(int64_t offset, int64_t sample_size, T * z1, T* signs, T* phi) const;
     void dphi(int64_t offset, int64_t sample_size, T * z1, T* signs, T* dphi) const;
+    void phi(int64_t offset, int64_t sample_size, T * z1, T* signs, T* phi, T* dphi_mean, T* zsq_mean) const;
 };
 
 }
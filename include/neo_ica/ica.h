@@ -13,9 +13,44 @@
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace neo_ica{
 
+/* NEWTON_CG : Dynamically sampled truncated Newton on W
+ * RELATIVE_LBFGS : Full-batch L-BFGS in relative coordinates W <- W(I+E), preconditioned by the approximate ICA Hessian
+ * ORTHOGONAL_LBFGS : Same as RELATIVE_LBFGS, with W constrained to the orthogonal group (Cayley retraction) */
+enum solver_type{
+    NEWTON_CG,
+    RELATIVE_LBFGS,
+    ORTHOGONAL_LBFGS
+};
+
+/* CHANNEL_MAJOR : data[c*NF + f], one channel after the other
+ * SAMPLE_MAJOR : data[f*NC + c], one sample after the other (e.g., EEGLAB .fdt files) */
+enum layout_type{
+    CHANNEL_MAJOR,
+    SAMPLE_MAJOR
+};
+
+/* Coordinates of an initial unmixing matrix
+ * WHITENED_INIT : K*K weights W0, as returned by ica(), applied to the data whitened by the new sphere
+ * RAW_INIT : K*NC unmixing matrix U of the centered data, e.g. W*S from a previous run, expressed in the coordinates of
+ *            the new sphere as W0 = U*S'*inv(S*S') */
+enum init_type{
+    WHITENED_INIT,
+    RAW_INIT
+};
+
+/* Storage of the whitened data during the optimization
+ * STORE_FULL : same precision as the input
+ * STORE_INT16 : 16-bit integers with a per-channel scale and offset
+ * STORE_BFLOAT16 : 16-bit brain floating point */
+enum storage_type{
+    STORE_FULL,
+    STORE_INT16,
+    STORE_BFLOAT16
+};
 
 namespace dflt{
     static const size_t iter = 500;
@@ -26,6 +61,14 @@ namespace dflt{
     static const int nthreads = 0;
     static const double tol = 1e-5;
     static const bool extended = true;
+    static const solver_type solver = NEWTON_CG;
+    static const size_t block_size = 0;
+    static const size_t pca_components = 0;
+    static const char * const scratch = "";
+    static const storage_type storage = STORE_FULL;
+    static const bool mixed_precision = false;
+    static const size_t extblocks = 10;
+    static const size_t levels = 1;
 }
 
 struct options{
@@ -36,9 +79,17 @@ struct options{
             double _fbatch = dflt::fbatch,
             double _nthreads = dflt::nthreads,
             bool _extended = dflt::extended,
-            double _tol = dflt::tol):
+            double _tol = dflt::tol,
+            solver_type _solver = dflt::solver,
+            size_t _block_size = dflt::block_size,
+            size_t _pca_components = dflt::pca_components,
+            std::string const & _scratch = dflt::scratch,
+            storage_type _storage = dflt::storage,
+            bool _mixed_precision = dflt::mixed_precision,
+            size_t _extblocks = dflt::extblocks,
+            size_t _levels = dflt::levels):
         iter(_iter), verbose(_verbose), theta(_theta), rho(_rho),
-        fbatch(_fbatch), nthreads(_nthreads), extended(_extended), tol(_tol){}
+        fbatch(_fbatch), nthreads(_nthreads), extended(_extended), tol(_tol), solver(_solver), block_size(_block_size), pca_components(_pca_components), scratch(_scratch), storage(_storage), mixed_precision(_mixed_precision), extblocks(_extblocks), levels(_levels){}
 
     size_t iter;
     unsigned int verbose;
@@ -48,11 +99,119 @@ struct options{
     int nthreads;
     bool extended;
     double tol;
+    solver_type solver;
+    //When non-zero, the data is not shuffled, whatever the solver : the samples are made of blocks of block_size
+    //consecutive points visited in a random order. This applies to the growing samples of NEWTON_CG and to the subsets
+    //of the coarse levels of the relative solvers, whose finest level uses all the points in any order
+    size_t block_size;
+    //When non-zero and smaller than NC, the data is projected onto its pca_components principal components before
+    //the unmixing
+    size_t pca_components;
+    //When non-empty, the whitened data is kept in a temporary file at this path instead of in memory, and the
+    //objective streams it block by block
+    std::string scratch;
+    //In memory only : the whitened data is kept on 16 bits and decoded, tile by tile, right before the products that
+    //consume it
+    storage_type storage;
+    //Double precision only : the whitened data and the NC*NF intermediates are single precision, while the optimizer
+    //state, the log-determinant and the accumulation of the NC*NC products stay in double precision
+    bool mixed_precision;
+    //Extended only : the kurtosis signs are re-estimated inside the optimization every extblocks iterations, from the
+    //moments of the sources at the last evaluation. If 0, they are only re-estimated once the optimization has
+    //converged, which then restarts it. A final check on the whole data is made in both cases
+    size_t extblocks;
+    //RELATIVE_LBFGS and ORTHOGONAL_LBFGS only : number of levels of the coarse-to-fine schedule. The weights are first
+    //fitted on NF/4^(levels-1) samples, then refined on 4 times more samples at each level, each level starting from
+    //the weights of the previous one, until the whole data is used. The tolerance of a level grows as the square root
+    //of its subsampling factor, since the weights are not estimated better than that on fewer samples. Levels of
+    //fewer than 32*K*K samples are skipped. 1 : no coarse level. NEWTON_CG already grows its samples from fbatch
+    size_t levels;
 };
 
+/* Unmixes the NC*NF channel-major data. With K = opt.pca_components (or NC), W receives the K*K weights and S the
+ * K*NC sphering matrix, both row-major, so that the sources are W*S*(data - mean) */
 template<class ScalarType>
 void ica(ScalarType const * data, ScalarType* W, ScalarType* S, int64_t NC, int64_t NF, options const & opt = options());
 
+template<class ScalarType>
+void ica(ScalarType const * data, ScalarType* W, ScalarType* S, int64_t NC, int64_t NF, layout_type layout, options const & opt = options());
+
+/* Same as above, on the NC*NF values of type ScalarType stored in the raw binary file at path, starting at the given
+ * byte offset, which must be a multiple of sizeof(ScalarType). The file is mapped read-only and is never copied as a
+ * whole */
+template<class ScalarType>
+void ica(std::string const & path, ScalarType* W, ScalarType* S, int64_t NC, int64_t NF, layout_type layout, options const & opt = options(), size_t offset = 0);
+
+/* Same as ica(data, W, S, NC, NF, layout, opt), starting from the initial unmixing matrix W0 instead of the identity */
+template<class ScalarType>
+void ica(ScalarType const * data, ScalarType* W, ScalarType* S, int64_t NC, int64_t NF, layout_type layout, ScalarType const * W0, init_type init, options const & opt = options());
+
+/* One of the problems of ica_batch(), with the same arguments as ica() */
+template<class ScalarType>
+struct ica_problem{
+    ica_problem(ScalarType const * _data, ScalarType * _W, ScalarType * _S, int64_t _NC, int64_t _NF, layout_type _layout = CHANNEL_MAJOR) :
+        data(_data), W(_W), S(_S), NC(_NC), NF(_NF), layout(_layout){ }
+
+    ScalarType const * data;
+    ScalarType * W;
+    ScalarType * S;
+    int64_t NC;
+    int64_t NF;
+    layout_type layout;
+};
+
+/* Solves many small independent problems with the same options
+ *
+ * Each thread solves whole problems with single-threaded kernels, and picks the next one as soon as it is done, the
+ * largest problems being started first. opt.nthreads sets the number of threads (0 : all). With opt.scratch, each
+ * problem gets its own file, suffixed by its index. Errors are rethrown once all the problems are done.
+ * With the L-BFGS solvers, the problems with at most 8 components and a small amount of data are solved in groups of
+ * up to 16 problems of the same size, whose iterations advance in lockstep (see umintl::lockstep_minimizer), with the
+ * same sign updates as ica(). With opt.levels > 1, all the problems are solved one by one. */
+template<class ScalarType>
+void ica_batch(std::vector< ica_problem<ScalarType> > const & problems, options const & opt = options());
+
+/* ICA on recordings of NC channels and NF samples, split into stages whose results and buffers are kept between calls
+ *
+ * whiten : computes the means and the K*NC sphering matrix of the data, and the whitened data, shuffled in the same
+ *          pass unless opt.block_size is set. The buffers are reused for the next recording of the same shape.
+ * prepare : moves the whitened data to its storage (opt.storage, opt.scratch, opt.mixed_precision) and estimates the
+ *           initial source signs. Called by fit() when needed.
+ * fit : optimizes the K*K weights, from the identity or from a given initial matrix (see init_type). The options that
+ *       shape the data (pca_components, block_size, scratch, storage, mixed_precision) are the ones given to the
+ *       constructor; the others may change from one fit to the next.
+ * unmix : sources = W*S*(data - means), K*NF channel-major.
+ *
+ * ica() is a whiten, fit on a temporary engine.
+ */
+template<class ScalarType>
+class ica_engine{
+    ica_engine(ica_engine const &);
+    ica_engine & operator=(ica_engine const &);
+
+public:
+    class impl;
+
+    ica_engine(int64_t NC, int64_t NF, options const & opt = options());
+    ~ica_engine();
+
+    void whiten(ScalarType const * data, layout_type layout = CHANNEL_MAJOR);
+    void prepare();
+    void fit();
+    void fit(options const & opt);
+    void fit(ScalarType const * W0, init_type init = RAW_INIT);
+    void fit(options const & opt, ScalarType const * W0, init_type init = RAW_INIT);
+    void unmix(ScalarType const * data, ScalarType * sources, layout_type layout = CHANNEL_MAJOR) const;
+
+    int64_t components() const;
+    /* Row-major K*K and K*NC, as for ica() */
+    ScalarType const * weights() const;
+    ScalarType const * sphere() const;
+
+private:
+    impl * impl_;
+};
+
 }
 
 #endif
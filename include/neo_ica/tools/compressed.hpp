@@ -0,0 +1,108 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef NEO_ICA_TOOLS_COMPRESSED_HPP_
+#define NEO_ICA_TOOLS_COMPRESSED_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "neo_ica/ica.h"
+
+namespace neo_ica
+{
+namespace tools
+{
+
+/* NC channels of NF samples stored on 16 bits
+ *
+ * STORE_INT16 : x = offset[c] + scale[c]*q, with q a signed 16-bit integer. The range of each channel is mapped onto
+ * [-32767, 32767], which keeps about 4.5 significant digits for whitened data.
+ * STORE_BFLOAT16 : the upper half of the single-precision representation of x, rounded to nearest even (3 digits).
+ */
+template<class T>
+class compressed_data{
+    static uint16_t to_bfloat16(float x){
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        bits += 0x7FFF + ((bits >> 16) & 1);
+        return (uint16_t)(bits >> 16);
+    }
+
+    static T from_bfloat16(uint16_t x){
+        uint32_t bits = (uint32_t)x << 16;
+        float res;
+        std::memcpy(&res, &bits, sizeof(res));
+        return (T)res;
+    }
+
+public:
+    compressed_data(storage_type storage, int64_t NC, int64_t NF) : storage_(storage), NC_(NC), NF_(NF), scale_(NC, 1), offset_(NC, 0), codes_(NC*NF){ }
+
+    int64_t channels() const { return NC_; }
+    int64_t samples() const { return NF_; }
+
+    /* Encodes the channel-major X[c*NF + f] */
+    void encode(T const * X){
+        #pragma omp parallel for
+        for(int64_t c = 0 ; c < NC_ ; ++c){
+            T const * x = X + c*NF_;
+            uint16_t * q = codes_.data() + c*NF_;
+            if(storage_==STORE_BFLOAT16){
+                for(int64_t f = 0 ; f < NF_ ; ++f)
+                    q[f] = to_bfloat16((float)x[f]);
+                continue;
+            }
+            T lo = *std::min_element(x, x + NF_);
+            T hi = *std::max_element(x, x + NF_);
+            offset_[c] = (hi + lo)/2;
+            scale_[c] = (hi > lo)?(hi - lo)/65534:1;
+            T inv = 1/scale_[c];
+            for(int64_t f = 0 ; f < NF_ ; ++f){
+                T v = std::floor((x[f] - offset_[c])*inv + (T)0.5);
+                q[f] = (uint16_t)(int16_t)std::max<T>(-32767, std::min<T>(32767, v));
+            }
+        }
+    }
+
+    /* X[c*ld + f] = sample first + f of channel c, for f < len */
+    void decode(int64_t first, int64_t len, T * X, int64_t ld) const{
+        #pragma omp parallel for
+        for(int64_t c = 0 ; c < NC_ ; ++c){
+            uint16_t const * q = codes_.data() + c*NF_ + first;
+            T * x = X + c*ld;
+            if(storage_==STORE_BFLOAT16){
+                for(int64_t f = 0 ; f < len ; ++f)
+                    x[f] = from_bfloat16(q[f]);
+            }
+            else{
+                T a = offset_[c];
+                T b = scale_[c];
+                for(int64_t f = 0 ; f < len ; ++f)
+                    x[f] = a + b*(T)(int16_t)q[f];
+            }
+        }
+    }
+
+private:
+    storage_type storage_;
+    int64_t NC_;
+    int64_t NF_;
+    std::vector<T> scale_;
+    std::vector<T> offset_;
+    std::vector<uint16_t> codes_;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,70 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef NEO_ICA_TOOLS_HESSIAN_HPP_
+#define NEO_ICA_TOOLS_HESSIAN_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+namespace neo_ica
+{
+
+/* Block-diagonal approximation of the Hessian
+ *
+ * Under the independence assumption, the Hessian in the relative parametrization W + W*D
+ * decouples into 2x2 blocks [h_ij 1; 1 h_ji] on (D_ij, D_ji), with h_ij = E[dphi(z_j)]E[z_i^2],
+ * and into scalars h_ii + 1 on the diagonal. The blocks are shifted so that their smallest
+ * eigenvalue is at least lambda_min. Solves H*D = R.
+ */
+template<class T>
+void solve_hessian_blocks(int64_t NC, T const * dphi_mean, T const * zsq_mean, T const * R, T * D){
+    T const lambda_min = (T)1e-2;
+    for(int64_t i = 0 ; i < NC ; ++i){
+        T hii = dphi_mean[i]*zsq_mean[i] + 1;
+        D[i*(NC+1)] = R[i*(NC+1)]/std::max(hii, lambda_min);
+        for(int64_t j = i+1 ; j < NC ; ++j){
+            T a = dphi_mean[j]*zsq_mean[i];
+            T b = dphi_mean[i]*zsq_mean[j];
+            T eigmin = (a + b - std::sqrt((a-b)*(a-b) + 4))/2;
+            if(eigmin < lambda_min){
+                a += lambda_min - eigmin;
+                b += lambda_min - eigmin;
+            }
+            T det = a*b - 1;
+            T rij = R[i+j*NC];
+            T rji = R[j+i*NC];
+            D[i+j*NC] = (b*rij - rji)/det;
+            D[j+i*NC] = (a*rji - rij)/det;
+        }
+    }
+}
+
+/* Same as above, restricted to skew-symmetric D, W*R(D) being a retraction on the orthogonal group.
+ * Each pair (D_ij, D_ji = -D_ij) has curvature h_ij + h_ji - E[z_i phi(z_i)] - E[z_j phi(z_j)], with the
+ * same regularization as above. Solves H*D = R for skew-symmetric R.
+ */
+template<class T>
+void solve_skew_hessian_blocks(int64_t NC, T const * dphi_mean, T const * zsq_mean, T const * zphi_mean, T const * R, T * D){
+    T const lambda_min = (T)1e-2;
+    for(int64_t i = 0 ; i < NC ; ++i){
+        D[i*(NC+1)] = 0;
+        for(int64_t j = i+1 ; j < NC ; ++j){
+            T k = dphi_mean[j]*zsq_mean[i] + dphi_mean[i]*zsq_mean[j] - zphi_mean[i] - zphi_mean[j];
+            T dij = 2*R[i+j*NC]/std::max(k, lambda_min);
+            D[i+j*NC] = dij;
+            D[j+i*NC] = -dij;
+        }
+    }
+}
+
+}
+
+#endif
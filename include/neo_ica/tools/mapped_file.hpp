@@ -0,0 +1,120 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef NEO_ICA_TOOLS_MAPPED_FILE_HPP_
+#define NEO_ICA_TOOLS_MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <string>
+
+#include "neo_ica/tools/mex.hpp"
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace neo_ica
+{
+namespace tools
+{
+
+/* Read-only memory mapping of a whole file
+ *
+ * The pages are shared with the page cache, so that several processes working on the same file do not duplicate it.
+ */
+class mapped_file{
+    mapped_file(mapped_file const &);
+    mapped_file & operator=(mapped_file const &);
+
+public:
+    mapped_file(std::string const & path) : data_(NULL), size_(0){
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if(file_==INVALID_HANDLE_VALUE)
+            throw neo_ica::exception("Cannot open " + path);
+        LARGE_INTEGER size;
+        GetFileSizeEx(file_, &size);
+        size_ = (size_t)size.QuadPart;
+        mapping_ = NULL;
+        if(size_ > 0){
+            mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+            if(mapping_)
+                data_ = (char const *)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+            if(data_==NULL){
+                close();
+                throw neo_ica::exception("Cannot map " + path);
+            }
+        }
+#else
+        fd_ = open(path.c_str(), O_RDONLY);
+        if(fd_ < 0)
+            throw neo_ica::exception("Cannot open " + path);
+        struct stat st;
+        if(fstat(fd_, &st) < 0){
+            close();
+            throw neo_ica::exception("Cannot stat " + path);
+        }
+        size_ = (size_t)st.st_size;
+        if(size_ > 0){
+            void * ptr = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd_, 0);
+            if(ptr==MAP_FAILED){
+                close();
+                throw neo_ica::exception("Cannot map " + path);
+            }
+            data_ = (char const *)ptr;
+            madvise(ptr, size_, MADV_SEQUENTIAL);
+        }
+#endif
+    }
+
+    ~mapped_file(){
+        close();
+    }
+
+    char const * data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void close(){
+#ifdef _WIN32
+        if(data_) UnmapViewOfFile(data_);
+        if(mapping_) CloseHandle(mapping_);
+        if(file_!=INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = NULL;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if(data_) munmap((void *)data_, size_);
+        if(fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = NULL;
+    }
+
+    char const * data_;
+    size_t size_;
+#ifdef _WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#else
+    int fd_;
+#endif
+};
+
+}
+}
+
+#endif
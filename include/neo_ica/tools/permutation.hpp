@@ -0,0 +1,146 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef NEO_ICA_TOOLS_PERMUTATION_HPP_
+#define NEO_ICA_TOOLS_PERMUTATION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+namespace neo_ica
+{
+namespace tools
+{
+
+/* Random permutation of [0, NF)
+ *
+ * Each index is sent to a bucket drawn from a counter-based generator (a hash of the seed and of the index), and
+ * the content of each bucket is then shuffled with a generator seeded by the bucket number. Since all the random
+ * numbers are functions of (seed, counter), the permutation only depends on the seed and on NF, and not on the
+ * number of threads. Applying it is a stable partition of the input into the buckets, followed by a Fisher-Yates
+ * shuffle within each bucket: the reads are sequential, there are only a few hundred write streams, and the random
+ * accesses stay within a bucket that fits in cache. The bucket of each index and the Fisher-Yates draws are
+ * computed once, in parallel, and reused for every column the permutation is applied to.
+ */
+class permutation{
+    static const size_t chunk_size = 1 << 16;
+    static const size_t bucket_size = 1 << 15;
+
+    static uint64_t mix(uint64_t z){
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    uint32_t draw_bucket(size_t i) const
+    { return (uint32_t)(((mix(seed_ + i*0x9e3779b97f4a7c15ULL) >> 32)*nbuckets_) >> 32); }
+
+    size_t nchunks() const
+    { return (NF_ + chunk_size - 1)/chunk_size; }
+
+public:
+    permutation(size_t NF, uint64_t seed = 0) : NF_(NF), seed_(mix(seed)), nbuckets_(std::max<size_t>(1, (NF + bucket_size - 1)/bucket_size)){
+        int64_t nc = nchunks();
+        offsets_.resize(nc*nbuckets_, 0);
+        starts_.resize(nbuckets_ + 1, 0);
+        bucket_.resize(NF_);
+        swap_.resize(NF_);
+
+        //Buckets, and bucket sizes within each chunk
+        #pragma omp parallel for
+        for(int64_t c = 0 ; c < nc ; ++c){
+            size_t * counts = &offsets_[c*nbuckets_];
+            for(size_t i = c*chunk_size ; i < std::min(NF_, (c+1)*chunk_size) ; ++i){
+                bucket_[i] = draw_bucket(i);
+                counts[bucket_[i]]++;
+            }
+        }
+
+        //Exclusive scan, bucket-major then chunk-major
+        size_t sum = 0;
+        for(size_t b = 0 ; b < nbuckets_ ; ++b){
+            starts_[b] = sum;
+            for(int64_t c = 0 ; c < nc ; ++c){
+                size_t n = offsets_[c*nbuckets_ + b];
+                offsets_[c*nbuckets_ + b] = sum;
+                sum += n;
+            }
+        }
+        starts_[nbuckets_] = sum;
+
+        //Fisher-Yates draws within each bucket
+        #pragma omp parallel for
+        for(int64_t b = 0 ; b < (int64_t)nbuckets_ ; ++b){
+            uint64_t state = mix(~seed_ + b);
+            for(size_t k = starts_[b+1] - starts_[b] ; k > 1 ; --k){
+                state += 0x9e3779b97f4a7c15ULL;
+                swap_[starts_[b] + k - 1] = (uint32_t)(((mix(state) >> 32)*k) >> 32);
+            }
+        }
+    }
+
+    size_t size() const { return NF_; }
+
+    /* out[k] = in[perm[k]] for k < NF. out must not alias in */
+    template<class T>
+    void apply(T const * in, T * out) const{
+        int64_t nc = nchunks();
+
+        #pragma omp parallel
+        {
+            std::vector<size_t> cursor(nbuckets_);
+            #pragma omp for
+            for(int64_t c = 0 ; c < nc ; ++c){
+                std::copy(offsets_.begin() + c*nbuckets_, offsets_.begin() + (c+1)*nbuckets_, cursor.begin());
+                for(size_t i = c*chunk_size ; i < std::min(NF_, (c+1)*chunk_size) ; ++i)
+                    out[cursor[bucket_[i]]++] = in[i];
+            }
+
+            #pragma omp for
+            for(int64_t b = 0 ; b < (int64_t)nbuckets_ ; ++b){
+                T * first = out + starts_[b];
+                uint32_t const * swap = &swap_[starts_[b]];
+                for(size_t k = starts_[b+1] - starts_[b] ; k > 1 ; --k)
+                    std::swap(first[k-1], first[swap[k-1]]);
+            }
+        }
+    }
+
+    /* Applies the permutation to each of the NC columns of in */
+    template<class T>
+    void apply(T const * in, size_t ldin, T * out, size_t ldout, size_t NC) const{
+        for(size_t c = 0 ; c < NC ; ++c)
+            apply(in + c*ldin, out + c*ldout);
+    }
+
+    /* perm[k] = index of the input element sent to position k */
+    void indices(size_t * perm) const{
+        std::vector<size_t> iota(NF_);
+        #pragma omp parallel for
+        for(int64_t i = 0 ; i < (int64_t)NF_ ; ++i)
+            iota[i] = i;
+        apply(iota.data(), perm);
+    }
+
+private:
+    size_t NF_;
+    uint64_t seed_;
+    size_t nbuckets_;
+    std::vector<size_t> offsets_;
+    std::vector<size_t> starts_;
+    std::vector<uint32_t> bucket_;
+    std::vector<uint32_t> swap_;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,92 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef NEO_ICA_TOOLS_SCRATCH_HPP_
+#define NEO_ICA_TOOLS_SCRATCH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "neo_ica/tools/mex.hpp"
+
+namespace neo_ica
+{
+namespace tools
+{
+
+/* Temporary file holding NC channels of NF samples, in blocks of block_size samples
+ *
+ * Each block is stored channel by channel (X[c*block_size + f]), so that a whole block is one contiguous read, and a
+ * range of samples within a block is one read per channel. The last block is padded. The file is removed on
+ * destruction. Reads and writes may come from any thread, but not concurrently.
+ */
+template<class T>
+class scratch_file{
+    scratch_file(scratch_file const &);
+    scratch_file & operator=(scratch_file const &);
+
+    std::streamoff position(int64_t b, int64_t c, int64_t f) const
+    { return ((std::streamoff)b*NC_*block_size_ + c*block_size_ + f)*(std::streamoff)sizeof(T); }
+
+public:
+    scratch_file(std::string const & path, int64_t NC, int64_t NF, int64_t block_size) : path_(path), NC_(NC), NF_(NF), block_size_(block_size){
+        stream_.open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!stream_)
+            throw neo_ica::exception("Cannot create scratch file " + path);
+    }
+
+    ~scratch_file(){
+        stream_.close();
+        std::remove(path_.c_str());
+    }
+
+    int64_t channels() const { return NC_; }
+    int64_t samples() const { return NF_; }
+    int64_t block_size() const { return block_size_; }
+    int64_t blocks() const { return (NF_ + block_size_ - 1)/block_size_; }
+
+    /* Writes the b-th block, X[c*block_size + f] */
+    void write(int64_t b, T const * X){
+        stream_.seekp(position(b, 0, 0));
+        stream_.write((char const *)X, sizeof(T)*NC_*block_size_);
+        if(!stream_)
+            throw neo_ica::exception("Cannot write scratch file " + path_);
+    }
+
+    /* X[c*ld + f] = sample first + f of channel c in the b-th block, for f < len */
+    void read(int64_t b, int64_t first, int64_t len, T * X, int64_t ld) const{
+        if(first==0 && len==block_size_ && ld==block_size_){
+            stream_.seekg(position(b, 0, 0));
+            stream_.read((char *)X, sizeof(T)*NC_*block_size_);
+        }
+        else{
+            for(int64_t c = 0 ; c < NC_ ; ++c){
+                stream_.seekg(position(b, c, first));
+                stream_.read((char *)(X + c*ld), sizeof(T)*len);
+            }
+        }
+        if(!stream_)
+            throw neo_ica::exception("Cannot read scratch file " + path_);
+    }
+
+private:
+    std::string path_;
+    int64_t NC_;
+    int64_t NF_;
+    int64_t block_size_;
+    mutable std::fstream stream_;
+};
+
+}
+}
+
+#endif
@@ -11,32 +11,27 @@
 #define NEO_ICA_TOOLS_SHUFFLE_HPP_
 
 #include <cstddef>
-#include <random>
+#include <vector>
+
+#include "neo_ica/tools/permutation.hpp"
 
 namespace neo_ica
 {
 
+/* Fills perms with a random permutation of [0, NF) */
+inline void random_permutation(size_t* perms, size_t NF, uint64_t seed = 0){
+    tools::permutation(NF, seed).indices(perms);
+}
+
+/* Shuffles the NF samples of each of the NC channels of data, with the same permutation for all channels */
 template<class ScalarType>
-void shuffle(ScalarType* data, size_t NC, size_t NF){
-    size_t* perms = new size_t[NF];
-    ScalarType * shuffled_va = new ScalarType[NF];
-
-    std::minstd_rand gen(0);
-    for(size_t i = 0 ; i < NF ; ++i)
-        perms[i] = i;
-    for(size_t i = 0 ; i < NF ; ++i){
-        size_t j = std::uniform_int_distribution<size_t>(i, NF-1)(gen);
-        std::swap(perms[i], perms[j]);
-    }
+void shuffle(ScalarType* data, size_t NC, size_t NF, uint64_t seed = 0){
+    tools::permutation perm(NF, seed);
+    std::vector<ScalarType> shuffled_va(NF);
     for(size_t c = 0 ; c < NC ; ++c){
-        for(size_t f = 0 ; f < NF ; ++f)
-            shuffled_va[f] = data[c*NF+perms[f]];
-        for(size_t f = 0 ; f < NF ; ++f)
-            data[c*NF+f] = shuffled_va[f];
+        perm.apply(data + c*NF, shuffled_va.data());
+        std::copy(shuffled_va.begin(), shuffled_va.end(), data + c*NF);
     }
-
-    delete[] shuffled_va;
-    delete[] perms;
 }
 
 }
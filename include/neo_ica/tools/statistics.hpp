@@ -0,0 +1,181 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef NEO_ICA_TOOLS_STATISTICS_HPP_
+#define NEO_ICA_TOOLS_STATISTICS_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+namespace neo_ica
+{
+namespace tools
+{
+
+/* Per-channel mean, variance, skewness and kurtosis, from the power sums of the samples up to the fourth order
+ *
+ * accumulate() adds a chunk of samples in a single sweep. The sums run on independent accumulators, which vectorize
+ * (along the samples of each channel in channel-major chunks, across the channels in sample-major ones), and are
+ * flushed into double precision every few hundred samples, so that a chunk may be as long as a whole channel.
+ * Threads accumulate their own statistics and merge() them. Only the powers up to order are summed : the mean needs
+ * order 1, the variance order 2, the skewness order 3 and the kurtosis order 4. The sums are taken around the
+ * optional shift, which should be close to the means when these are large with respect to the spread (e.g., one of
+ * the samples), to avoid cancellations in the central moments. */
+template<class T>
+class channel_statistics{
+    static const int64_t lanes = 8;
+    static const int64_t flush = 512;
+
+    /* s[p-1] += sum((x[f] - k)^p) for f < len and p <= Order */
+    template<int Order>
+    static void sweep(int64_t len, T const * x, T k, double * s){
+        for(int64_t f0 = 0 ; f0 < len ; f0 += flush){
+            int64_t f1 = std::min(f0 + flush, len);
+            T a[4][lanes] = {};
+            int64_t f = f0;
+            for( ; f + lanes <= f1 ; f += lanes)
+                for(int64_t u = 0 ; u < lanes ; ++u)
+                    add<Order>(x[f+u] - k, a, u);
+            for( ; f < f1 ; ++f)
+                add<Order>(x[f] - k, a, 0);
+            for(int p = 0 ; p < Order ; ++p)
+                for(int64_t u = 0 ; u < lanes ; ++u)
+                    s[p] += a[p][u];
+        }
+    }
+
+    /* Same as above for the len samples X[f*ld + c], the accumulators being the channels */
+    template<int Order>
+    void sweep_samples(int64_t len, T const * X, int64_t ld, T const * shift){
+        std::vector<T> & a = rows_;
+        a.resize(Order*NC_);
+        zeros_.resize(shift?0:NC_, 0);
+        if(shift==NULL)
+            shift = zeros_.data();
+        for(int64_t f0 = 0 ; f0 < len ; f0 += flush){
+            int64_t f1 = std::min(f0 + flush, len);
+            std::fill(a.begin(), a.end(), 0);
+            for(int64_t f = f0 ; f < f1 ; ++f){
+                T const * x = X + f*ld;
+                for(int64_t c = 0 ; c < NC_ ; ++c){
+                    T v = x[c] - shift[c];
+                    T v2 = v*v;
+                    a[c] += v;
+                    if(Order >= 2) a[NC_ + c] += v2;
+                    if(Order >= 3) a[2*NC_ + c] += v2*v;
+                    if(Order >= 4) a[3*NC_ + c] += v2*v2;
+                }
+            }
+            for(int p = 0 ; p < Order ; ++p)
+                for(int64_t c = 0 ; c < NC_ ; ++c)
+                    sums_[4*c + p] += a[p*NC_ + c];
+        }
+    }
+
+    template<int Order>
+    static void add(T v, T (&a)[4][lanes], int64_t u){
+        T v2 = v*v;
+        a[0][u] += v;
+        if(Order >= 2) a[1][u] += v2;
+        if(Order >= 3) a[2][u] += v2*v;
+        if(Order >= 4) a[3][u] += v2*v2;
+    }
+
+public:
+    channel_statistics(int64_t NC, int order = 4) : NC_(NC), order_(order), n_(0), sums_(4*NC, 0){ }
+
+    int64_t channels() const { return NC_; }
+    int64_t count() const { return n_; }
+
+    void clear(){
+        n_ = 0;
+        std::fill(sums_.begin(), sums_.end(), 0);
+    }
+
+    /* Adds the samples X[c*ld + f] - shift[c], for f < len. No shift if shift is NULL */
+    void accumulate(int64_t len, T const * X, int64_t ld, T const * shift = NULL){
+        for(int64_t c = 0 ; c < NC_ ; ++c){
+            T const * x = X + c*ld;
+            T k = shift?shift[c]:0;
+            double * s = sums_.data() + 4*c;
+            switch(order_){
+                case 1: sweep<1>(len, x, k, s); break;
+                case 2: sweep<2>(len, x, k, s); break;
+                case 3: sweep<3>(len, x, k, s); break;
+                default: sweep<4>(len, x, k, s); break;
+            }
+        }
+        n_ += len;
+    }
+
+    /* Adds the samples X[f*ld + c] - shift[c], for f < len. No shift if shift is NULL */
+    void accumulate_samples(int64_t len, T const * X, int64_t ld, T const * shift = NULL){
+        switch(order_){
+            case 1: sweep_samples<1>(len, X, ld, shift); break;
+            case 2: sweep_samples<2>(len, X, ld, shift); break;
+            case 3: sweep_samples<3>(len, X, ld, shift); break;
+            default: sweep_samples<4>(len, X, ld, shift); break;
+        }
+        n_ += len;
+    }
+
+    /* Adds the samples accumulated by other, around the same shift */
+    void merge(channel_statistics const & other){
+        n_ += other.n_;
+        for(int64_t i = 0 ; i < 4*NC_ ; ++i)
+            sums_[i] += other.sums_[i];
+    }
+
+    /* Mean of the shifted samples */
+    double mean(int64_t c) const{
+        return sums_[4*c]/n_;
+    }
+
+    /* Unbiased variance */
+    double variance(int64_t c) const{
+        return central(c, 2)*n_/(n_ - 1);
+    }
+
+    double skewness(int64_t c) const{
+        return central(c, 3)/std::pow(central(c, 2), 1.5);
+    }
+
+    /* Excess kurtosis : 0 for a gaussian, positive for super-gaussians, negative for sub-gaussians */
+    double kurtosis(int64_t c) const{
+        double m2 = central(c, 2);
+        return central(c, 4)/(m2*m2) - 3;
+    }
+
+private:
+    /* Central moment of the given order, from the power sums */
+    double central(int64_t c, int order) const{
+        double const * s = sums_.data() + 4*c;
+        double m = s[0]/n_, e2 = s[1]/n_, e3 = s[2]/n_, e4 = s[3]/n_;
+        switch(order){
+            case 2: return e2 - m*m;
+            case 3: return e3 - 3*m*e2 + 2*m*m*m;
+            default: return e4 - 4*m*e3 + 6*m*m*e2 - 3*m*m*m*m;
+        }
+    }
+
+    int64_t NC_;
+    int order_;
+    int64_t n_;
+    std::vector<double> sums_;
+    std::vector<T> rows_;
+    std::vector<T> zeros_;
+};
+
+}
+}
+
+#endif
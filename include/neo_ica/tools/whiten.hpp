@@ -8,7 +8,15 @@
  * ===========================*/
 
 
+#include "neo_ica/ica.h"
 #include "neo_ica/backend/backend.hpp"
+#include "neo_ica/tools/permutation.hpp"
+#include "neo_ica/tools/scratch.hpp"
+#include "neo_ica/tools/statistics.hpp"
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <future>
 #include <iostream>
 
 namespace neo_ica
@@ -17,6 +25,61 @@ namespace neo_ica
 namespace detail
 {
 
+    /* Symmetric eigensolver
+     *
+     * Uses QR iterations (syev) for small matrices, the divide-and-conquer algorithm (syevd) for larger ones, and the
+     * MRRR algorithm (syevr) when only the largest eigenpairs are needed. The workspaces only grow, and are reused by
+     * the subsequent calls.
+     */
+    template<class ScalarType>
+    class symmetric_eigensolver{
+        typedef typename backend<ScalarType>::size_t size_type;
+        static const int64_t divide_and_conquer_threshold = 64;
+
+        void reserve(size_type lwork, size_type liwork){
+            if((size_type)work_.size() < lwork) work_.resize(lwork);
+            if((size_type)iwork_.size() < liwork) iwork_.resize(liwork);
+        }
+
+    public:
+        /* A = U, w = eigenvalues in ascending order */
+        void operator()(int64_t n, ScalarType * A, ScalarType * w){
+            if(n < divide_and_conquer_threshold){
+                backend<ScalarType>::syev('V','U',n,A,n,w);
+                return;
+            }
+            //Queries zeroed first : a LAPACK with 32-bit integers only writes their low half
+            ScalarType qwork = 0;
+            size_type qiwork = 0;
+            backend<ScalarType>::syevd('V','U',n,A,n,w,&qwork,-1,&qiwork,-1);
+            reserve((size_type)qwork, qiwork);
+            backend<ScalarType>::syevd('V','U',n,A,n,w,work_.data(),work_.size(),iwork_.data(),iwork_.size());
+        }
+
+        /* Z = eigenvectors associated with the K largest eigenvalues w, in ascending order. A is destroyed */
+        void largest(int64_t n, int64_t K, ScalarType * A, ScalarType * w, ScalarType * Z){
+            size_type m = 0;
+            ScalarType qwork = 0;
+            size_type qiwork = 0;
+            isuppz_.resize(2*std::max<int64_t>(K,1));
+            backend<ScalarType>::syevr('V','I','U',n,A,n,n-K+1,n,&m,w,Z,n,isuppz_.data(),&qwork,-1,&qiwork,-1);
+            reserve((size_type)qwork, qiwork);
+            backend<ScalarType>::syevr('V','I','U',n,A,n,n-K+1,n,&m,w,Z,n,isuppz_.data(),work_.data(),work_.size(),iwork_.data(),iwork_.size());
+        }
+
+    private:
+        std::vector<ScalarType> work_;
+        std::vector<size_type> iwork_;
+        std::vector<size_type> isuppz_;
+    };
+
+    template<class ScalarType>
+    symmetric_eigensolver<ScalarType> & eigensolver(){
+        static thread_local symmetric_eigensolver<ScalarType> res;
+        return res;
+    }
+
+    /* out = inverse(sqrtm(in)). in is destroyed */
     template<class ScalarType>
     static void inv_sqrtm(int64_t C, ScalarType * in, ScalarType * out){
 
@@ -24,7 +87,7 @@ namespace detail
         ScalarType * UD = new ScalarType[C*C];
 
         //in = U
-        backend<ScalarType>::syev('V','U',C,in,C,D);
+        eigensolver<ScalarType>()(C,in,D);
         //UD = U*diag(D)
         for (int64_t j=0; j<C; ++j) {
           ScalarType dj = std::max<ScalarType>(1e-6, D[j]);
@@ -40,55 +103,340 @@ namespace detail
         delete[] UD;
     }
 
+    /* out = U_K*inverse(sqrt(D_K)), the C*K projection onto the K principal components of in, by decreasing variance.
+     * in is destroyed */
+    template<class ScalarType>
+    static void inv_sqrt_pca(int64_t C, int64_t K, ScalarType * in, ScalarType * out){
+        ScalarType * D = new ScalarType[C];
+        ScalarType * U = new ScalarType[C*K];
+
+        eigensolver<ScalarType>().largest(C,K,in,D,U);
+        for (int64_t j=0; j<K; ++j) {
+          ScalarType dj = std::max<ScalarType>(1e-6, D[K-1-j]);
+          ScalarType lambda = 1/std::sqrt(dj);
+          for (int64_t i=0; i<C; ++i)
+              out[j*C+i] = U[(K-1-j)*C+i]*lambda;
+        }
+
+        delete[] D;
+        delete[] U;
+    }
+
 }
 
+/* buf[c*ldbuf + f] = data(c, i(f0 + f)) - shift[c] for f < bs, where data(c, f) is data[c*DataNF + f] in channel-major
+ * layout and data[f*NC + c] in sample-major layout, and i(f) is idx[f], or f if idx is NULL */
 template<class ScalarType>
-void compute_mean(ScalarType* A, int64_t NC, int64_t NF, ScalarType* x){
-    #pragma omp parallel for
-    for(int64_t c = 0 ; c < NC ;++c){
-        ScalarType sum = 0;
-        for(int64_t f = 0 ; f < NF ; ++f)
-            sum += A[c*NF+f];
-        x[c] = sum/(ScalarType)NF;
+void gather_block(int64_t NC, int64_t DataNF, ScalarType const * data, layout_type layout, int64_t f0, int64_t bs, ScalarType const * shift, ScalarType * buf, int64_t ldbuf, size_t const * idx = NULL){
+    if(layout==SAMPLE_MAJOR){
+        for(int64_t f = 0 ; f < bs ; ++f){
+            ScalarType const * x = data + (idx?idx[f0+f]:f0+f)*NC;
+            for(int64_t c = 0 ; c < NC ; ++c)
+                buf[c*ldbuf+f] = x[c] - shift[c];
+        }
+    }
+    else if(idx){
+        for(int64_t c = 0 ; c < NC ; ++c){
+            ScalarType const * x = data + c*DataNF;
+            ScalarType * y = buf + c*ldbuf;
+            ScalarType k = shift[c];
+            for(int64_t f = 0 ; f < bs ; ++f)
+                y[f] = x[idx[f0+f]] - k;
+        }
+    }
+    else{
+        for(int64_t c = 0 ; c < NC ; ++c){
+            ScalarType const * x = data + c*DataNF + f0;
+            ScalarType * y = buf + c*ldbuf;
+            ScalarType k = shift[c];
+            for(int64_t f = 0 ; f < bs ; ++f)
+                y[f] = x[f] - k;
+        }
     }
 }
 
+/* Channel means and covariance of the first NF samples of data, in a single parallel pass
+ *
+ * Each thread centers blocks of samples around the first sample of each channel (which avoids the cancellation of
+ * the naive formula when the means are large), and accumulates their channel_statistics and their syrk in double
+ * precision. The partial results are then reduced, and the centering is folded into the covariance :
+ * Cov = 1/(NF-1)*(S - NF*m*m'), with m and S the shifted means and second moments. data is never written.
+ */
+template<class ScalarType>
+void compute_moments(int64_t NC, int64_t DataNF, int64_t NF, ScalarType const * data, ScalarType * means, ScalarType * Cov, layout_type layout = CHANNEL_MAJOR){
+    static const int64_t block = 1024;
+    int64_t nblocks = (NF + block - 1)/block;
 
+    std::vector<ScalarType> shift(NC, 0);
+    if(NF > 0)
+        gather_block(NC, DataNF, data, layout, 0, 1, shift.data(), shift.data(), 1);
 
-template<class ScalarType>
-void whiten(int64_t NC, int64_t DataNF, int64_t NF, ScalarType const * cdata, ScalarType * Sphere, ScalarType * white_data){
-    ScalarType * Cov = new ScalarType[NC*NC];
-    ScalarType * means = new ScalarType[NC];
+    tools::channel_statistics<ScalarType> stats(NC, 1);
+    std::vector<double> sumsq(NC*NC, 0);
 
-    //We remove constness here to normalize the data (and add the mean back afterwards)
-    ScalarType * data = const_cast<ScalarType *>(cdata);
-    compute_mean(data,NC,NF,means);
+    #pragma omp parallel
+    {
+        std::vector<ScalarType> buf(block*NC);
+        std::vector<ScalarType> Cb(NC*NC);
+        tools::channel_statistics<ScalarType> pstats(NC, 1);
+        std::vector<double> psumsq(NC*NC, 0);
+        #pragma omp for
+        for(int64_t b = 0 ; b < nblocks ; ++b){
+            int64_t f0 = b*block;
+            int64_t bs = std::min(block, NF - f0);
+            gather_block(NC, DataNF, data, layout, f0, bs, shift.data(), buf.data(), block);
+            pstats.accumulate(bs, buf.data(), block);
+            //Lower triangle of buf'*buf
+            backend<ScalarType>::syrk('L',Trans,NC,bs,1,buf.data(),block,0,Cb.data(),NC);
+            for(int64_t j = 0 ; j < NC ; ++j)
+                for(int64_t i = j ; i < NC ; ++i)
+                    psumsq[i+j*NC] += Cb[i+j*NC];
+        }
+        #pragma omp critical
+        {
+            stats.merge(pstats);
+            for(int64_t i = 0 ; i < NC*NC ; ++i)
+                sumsq[i] += psumsq[i];
+        }
+    }
 
-    //Substract mean
-    for(int64_t c = 0 ; c < NC ;++c)
-        for(int64_t f = 0 ; f < DataNF ; ++f)
-            data[c*DataNF+f] -= means[c];
+    for(int64_t c = 0 ; c < NC ; ++c)
+        means[c] = (ScalarType)(shift[c] + stats.mean(c));
+    for(int64_t j = 0 ; j < NC ; ++j)
+        for(int64_t i = j ; i < NC ; ++i){
+            ScalarType cij = (ScalarType)((sumsq[i+j*NC] - NF*stats.mean(i)*stats.mean(j))/(NF-1));
+            Cov[i+j*NC] = cij;
+            Cov[j+i*NC] = cij;
+        }
+}
 
-    //Cov = 1/(N-1)*data_copy*data_copy'
-    ScalarType alpha = (ScalarType)(1)/(NF-1);
-    backend<ScalarType>::gemm(Trans,NoTrans,NC,NC,DataNF,alpha,data,DataNF,data,DataNF,0,Cov,NC);
+/* Computes the channel means and the sphering matrix of the first NF samples of data */
+template<class ScalarType>
+void compute_sphere(int64_t NC, int64_t DataNF, int64_t NF, ScalarType const * data, ScalarType * Sphere, ScalarType * means, layout_type layout = CHANNEL_MAJOR){
+    ScalarType * Cov = new ScalarType[NC*NC];
 
+    compute_moments(NC, DataNF, NF, data, means, Cov, layout);
 
     //Sphere = inverse(sqrtm(Cov))
     detail::inv_sqrtm<ScalarType>(NC,Cov,Sphere);
 //    for(int64_t i = 0 ; i < NC*NC ;++i)
 //        Sphere[i]*=2;  Not sure why EEGLAB multiplies the sphere by 2
 
-    //white_data = sphere*data
-    backend<ScalarType>::gemm(NoTrans,NoTrans,NF,NC,NC,1,data,DataNF,Sphere,NC,0,white_data,NF);
+    delete[] Cov;
+}
+
+/* Per-channel statistics up to the given order of the first NF samples of data, around shift (none if NULL), in a
+ * single parallel pass */
+template<class ScalarType>
+tools::channel_statistics<ScalarType> compute_statistics(int64_t NC, int64_t DataNF, int64_t NF, ScalarType const * data, ScalarType const * shift, int order = 4, layout_type layout = CHANNEL_MAJOR){
+    static const int64_t block = 1024;
+    int64_t nblocks = (NF + block - 1)/block;
+    tools::channel_statistics<ScalarType> stats(NC, order);
+    #pragma omp parallel
+    {
+        tools::channel_statistics<ScalarType> pstats(NC, order);
+        #pragma omp for
+        for(int64_t b = 0 ; b < nblocks ; ++b){
+            int64_t f0 = b*block;
+            int64_t bs = std::min(block, NF - f0);
+            if(layout==SAMPLE_MAJOR)
+                pstats.accumulate_samples(bs, data + f0*NC, NC, shift);
+            else
+                pstats.accumulate(bs, data + f0, DataNF, shift);
+        }
+        #pragma omp critical
+        stats.merge(pstats);
+    }
+    return stats;
+}
+
+/* Channel means of the first NF samples of data */
+template<class ScalarType>
+void compute_means(int64_t NC, int64_t DataNF, int64_t NF, ScalarType const * data, ScalarType * means, layout_type layout = CHANNEL_MAJOR){
+    //Around the first sample, as in compute_moments
+    std::vector<ScalarType> shift(NC, 0);
+    if(NF > 0)
+        gather_block(NC, DataNF, data, layout, 0, 1, shift.data(), shift.data(), 1);
+    tools::channel_statistics<ScalarType> stats = compute_statistics(NC, DataNF, NF, data, shift.data(), 1, layout);
+    for(int64_t c = 0 ; c < NC ; ++c)
+        means[c] = (ScalarType)(shift[c] + stats.mean(c));
+}
+
+/* Y = Cov*Q, with Cov the covariance of the first NF samples of data and Q a NC*L matrix, without forming Cov.
+ * Each thread accumulates (X_b - means)'*((X_b - means)*Q) over blocks of samples X_b. */
+template<class ScalarType>
+void covariance_product(int64_t NC, int64_t DataNF, int64_t NF, ScalarType const * data, ScalarType const * means, int64_t L, ScalarType const * Q, ScalarType * Y, layout_type layout = CHANNEL_MAJOR){
+    static const int64_t block = 1024;
+    int64_t nblocks = (NF + block - 1)/block;
+    std::fill(Y, Y + NC*L, (ScalarType)0);
+
+    #pragma omp parallel
+    {
+        std::vector<ScalarType> buf(block*NC);
+        std::vector<ScalarType> XQ(block*L);
+        std::vector<ScalarType> pY(NC*L, 0);
+        #pragma omp for
+        for(int64_t b = 0 ; b < nblocks ; ++b){
+            int64_t f0 = b*block;
+            int64_t bs = std::min(block, NF - f0);
+            gather_block(NC, DataNF, data, layout, f0, bs, means, buf.data(), block);
+            backend<ScalarType>::gemm(NoTrans,NoTrans,bs,L,NC,1,buf.data(),block,Q,NC,0,XQ.data(),block);
+            backend<ScalarType>::gemm(Trans,NoTrans,NC,L,bs,1,buf.data(),block,XQ.data(),block,1,pY.data(),NC);
+        }
+        #pragma omp critical
+        {
+            for(int64_t i = 0 ; i < NC*L ; ++i)
+                Y[i] += pY[i]/(NF-1);
+        }
+    }
+}
+
+/* Channel means and NC*K projection onto the K principal components, using a randomized range finder
+ *
+ * Halko, Martinsson & Tropp (2011) : "Finding structure with randomness". The range of the covariance is sampled
+ * with K + oversampling gaussian vectors, refined by power iterations, and the covariance is then only
+ * diagonalized on that subspace. The covariance is never formed : each product with it is one pass over the data,
+ * so that the cost is O(NF*NC*K) instead of O(NF*NC^2 + NC^3).
+ */
+template<class ScalarType>
+void compute_randomized_pca(int64_t NC, int64_t DataNF, int64_t NF, int64_t K, ScalarType const * data, ScalarType * Projection, ScalarType * means,
+                            layout_type layout = CHANNEL_MAJOR, int64_t oversampling = 10, int64_t power_iterations = 1){
+    int64_t L = std::min(NC, K + oversampling);
+    std::vector<ScalarType> Q(NC*L), Y(NC*L), tau(L), B(L*L), D(L);
+
+    compute_means(NC, DataNF, NF, data, means, layout);
+
+    //Q = orth(Cov*Omega)
+    std::mt19937 gen(0);
+    std::normal_distribution<ScalarType> normal;
+    for(int64_t i = 0 ; i < NC*L ; ++i)
+        Q[i] = normal(gen);
+    for(int64_t it = 0 ; it <= power_iterations ; ++it){
+        covariance_product(NC, DataNF, NF, data, means, L, Q.data(), Y.data(), layout);
+        backend<ScalarType>::geqrf(NC,L,Y.data(),NC,tau.data());
+        backend<ScalarType>::orgqr(NC,L,L,Y.data(),NC,tau.data());
+        std::swap(Q, Y);
+    }
 
-    //Readd mean
-    for(int64_t c = 0 ; c < NC ;++c)
-        for(int64_t f = 0 ; f < NF ; ++f)
-            data[c*DataNF+f] += means[c];
+    //B = Q'*Cov*Q = V*D*V'
+    covariance_product(NC, DataNF, NF, data, means, L, Q.data(), Y.data(), layout);
+    backend<ScalarType>::gemm(Trans,NoTrans,L,L,NC,1,Q.data(),NC,Y.data(),NC,0,B.data(),L);
+    detail::eigensolver<ScalarType>()(L,B.data(),D.data());
 
-    delete[] means;
+    //Projection = Q*V_K*inverse(sqrt(D_K)), by decreasing variance
+    backend<ScalarType>::gemm(NoTrans,NoTrans,NC,K,L,1,Q.data(),NC,B.data()+(L-K)*L,L,0,Y.data(),NC);
+    for(int64_t j = 0 ; j < K ; ++j){
+        ScalarType lambda = 1/std::sqrt(std::max<ScalarType>(1e-6, D[L-1-j]));
+        for(int64_t i = 0 ; i < NC ; ++i)
+            Projection[j*NC+i] = Y[(K-1-j)*NC+i]*lambda;
+    }
+}
+
+/* Computes the channel means and the NC*K projection onto the K principal components of the first NF samples of data,
+ * scaled to unit variance. Relies on a randomized range finder when K is small compared to NC. */
+template<class ScalarType>
+void compute_pca(int64_t NC, int64_t DataNF, int64_t NF, int64_t K, ScalarType const * data, ScalarType * Projection, ScalarType * means, layout_type layout = CHANNEL_MAJOR){
+    //Each pass of the range finder costs about 2*NF*NC*(K+10), against NF*NC^2/2 for the covariance
+    if(16*(K + 10) <= NC){
+        compute_randomized_pca(NC, DataNF, NF, K, data, Projection, means, layout);
+        return;
+    }
+    ScalarType * Cov = new ScalarType[NC*NC];
+    compute_moments(NC, DataNF, NF, data, means, Cov, layout);
+    detail::inv_sqrt_pca<ScalarType>(NC,K,Cov,Projection);
     delete[] Cov;
 }
 
+/* white_data[f] = Sphere'*(data[perm[f]] - means) for f < NF
+ *
+ * The data is gathered through the permutation (if perm is not NULL), centered and sphered block by block through a
+ * small per-thread buffer, straight into the NK output channels. Sphere is NC*NK and white_data is NK*NF : the NC input
+ * channels are never staged in it.
+ */
+template<class ScalarType>
+void apply_sphere(int64_t NC, int64_t NK, int64_t DataNF, int64_t NF, ScalarType const * data, ScalarType const * means, ScalarType const * Sphere, tools::permutation const * perm, ScalarType * white_data, layout_type layout = CHANNEL_MAJOR){
+    static const int64_t block = 256;
+    int64_t nblocks = (NF + block - 1)/block;
+    std::vector<size_t> idx;
+    if(perm){
+        idx.resize(NF);
+        perm->indices(idx.data());
+    }
+
+    #pragma omp parallel
+    {
+        ScalarType * buf = new ScalarType[block*NC];
+        #pragma omp for
+        for(int64_t b = 0 ; b < nblocks ; ++b){
+            int64_t f0 = b*block;
+            int64_t bs = std::min(block, NF - f0);
+            gather_block(NC, DataNF, data, layout, f0, bs, means, buf, block, perm?idx.data():(size_t const *)NULL);
+            backend<ScalarType>::gemm(NoTrans,NoTrans,bs,NK,NC,1,buf,block,Sphere,NC,0,white_data+f0,NF);
+        }
+        delete[] buf;
+    }
+}
+
+/* Means and sphering matrix : the NC*NC inverse square root of the covariance or, if NK < NC, the NC*NK projection onto
+ * the NK principal components */
+template<class ScalarType>
+void compute_whitening(int64_t NC, int64_t NK, int64_t DataNF, int64_t NF, ScalarType const * data, ScalarType * Sphere, ScalarType * means, layout_type layout = CHANNEL_MAJOR){
+    if(NK < NC)
+        compute_pca(NC, DataNF, NF, NK, data, Sphere, means, layout);
+    else
+        compute_sphere(NC, DataNF, NF, data, Sphere, means, layout);
+}
+
+/* Same as apply_sphere(), into the blocks of a scratch file with NK channels, possibly stored in a lower precision
+ *
+ * The samples of each block are gathered in a shuffled order, and each block is written in the background while the next
+ * one is computed.
+ */
+template<class ScalarType, class StorageType>
+void apply_sphere(int64_t NC, int64_t NK, int64_t DataNF, int64_t NF, ScalarType const * data, ScalarType const * means, ScalarType const * Sphere, tools::scratch_file<StorageType> & file, layout_type layout = CHANNEL_MAJOR){
+    static const int64_t sub = 256;
+    int64_t B = file.block_size();
+    std::vector<ScalarType> white(NK*B, 0);
+    std::vector<StorageType> blocks[2];
+    blocks[0].resize(NK*B, 0);
+    blocks[1].resize(NK*B, 0);
+    std::future<void> pending;
+
+    for(int64_t b = 0 ; b < file.blocks() ; ++b){
+        int64_t f0 = b*B;
+        int64_t bs = std::min(B, NF - f0);
+        int64_t nsub = (bs + sub - 1)/sub;
+        std::vector<StorageType> & stored = blocks[b%2];
+
+        //Samples of the block, shuffled
+        std::vector<size_t> idx(bs);
+        tools::permutation(bs, b).indices(idx.data());
+        for(int64_t f = 0 ; f < bs ; ++f)
+            idx[f] += f0;
+
+        //white = Sphere'*(data[idx] - means)
+        #pragma omp parallel
+        {
+            std::vector<ScalarType> buf(sub*NC);
+            #pragma omp for
+            for(int64_t k = 0 ; k < nsub ; ++k){
+                int64_t s0 = k*sub;
+                int64_t ss = std::min(sub, bs - s0);
+                gather_block(NC, DataNF, data, layout, s0, ss, means, buf.data(), sub, idx.data());
+                backend<ScalarType>::gemm(NoTrans,NoTrans,ss,NK,NC,1,buf.data(),sub,Sphere,NC,0,white.data()+s0,B);
+            }
+        }
+
+        //Into the buffer written two steps ago
+        for(int64_t c = 0 ; c < NK ; ++c)
+            std::copy(white.begin() + c*B, white.begin() + c*B + bs, stored.begin() + c*B);
+
+        if(pending.valid())
+            pending.get();
+        pending = std::async(std::launch::async, [&file, &stored, b](){ file.write(b, stored.data()); });
+    }
+    if(pending.valid())
+        pending.get();
+}
+
 }
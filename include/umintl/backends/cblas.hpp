@@ -13,6 +13,7 @@
 
 #include <cstring>
 #include <algorithm> 
+#include <cmath>
 #include "cblas.h"
 
 namespace umintl{
@@ -50,6 +51,39 @@ namespace umintl{
         { return cblas_snrm2(N,x,1); }
         static ScalarType dot(size_t N, VectorType const & x, VectorType const & y)
         { return cblas_dsdot(N,x,1,y,1); }
+        static void waxpby(size_t N, ScalarType alpha, VectorType const & x, ScalarType beta, VectorType const & y, VectorType & w)
+        {
+            for(size_t i = 0 ; i < N ; ++i)
+                w[i] = alpha*x[i] + beta*y[i];
+        }
+        //Accumulated in double, as dot
+        static ScalarType axpy_dot(size_t N, ScalarType alpha, VectorType const & x, VectorType & y, VectorType const & z)
+        {
+            double res = 0;
+            for(size_t i = 0 ; i < N ; ++i){
+                y[i] += alpha*x[i];
+                res += (double)y[i]*z[i];
+            }
+            return (ScalarType)res;
+        }
+        //Accumulated in double, as dot
+        static ScalarType diff_dot(size_t N, VectorType const & x, VectorType const & y, VectorType const & z)
+        {
+            double res = 0;
+            for(size_t i = 0 ; i < N ; ++i)
+                res += ((double)x[i] - y[i])*z[i];
+            return (ScalarType)res;
+        }
+        //Squares accumulated in double, where they can neither overflow nor underflow
+        static ScalarType diff_nrm2(size_t N, VectorType const & x, VectorType const & y)
+        {
+            double res = 0;
+            for(size_t i = 0 ; i < N ; ++i){
+                double d = (double)x[i] - y[i];
+                res += d*d;
+            }
+            return (ScalarType)std::sqrt(res);
+        }
         static void symv(size_t N, ScalarType alpha, MatrixType const& A, VectorType const & x, ScalarType beta, VectorType & y)
         { cblas_ssymv(CblasRowMajor,CblasUpper,N,alpha,A,N,x,1,beta,y,1);  }
         static void gemv(size_t M, size_t N, ScalarType alpha, MatrixType const& A, VectorType const & x, ScalarType beta, VectorType & y)
@@ -96,6 +130,44 @@ namespace umintl{
         { return cblas_dnrm2(N,x,1); }
         static ScalarType dot(size_t N, VectorType const & x, VectorType const & y)
         { return cblas_ddot(N,x,1,y,1); }
+        static void waxpby(size_t N, ScalarType alpha, VectorType const & x, ScalarType beta, VectorType const & y, VectorType & w)
+        {
+            for(size_t i = 0 ; i < N ; ++i)
+                w[i] = alpha*x[i] + beta*y[i];
+        }
+        static ScalarType axpy_dot(size_t N, ScalarType alpha, VectorType const & x, VectorType & y, VectorType const & z)
+        {
+            ScalarType res = 0;
+            for(size_t i = 0 ; i < N ; ++i){
+                y[i] += alpha*x[i];
+                res += y[i]*z[i];
+            }
+            return res;
+        }
+        static ScalarType diff_dot(size_t N, VectorType const & x, VectorType const & y, VectorType const & z)
+        {
+            ScalarType res = 0;
+            for(size_t i = 0 ; i < N ; ++i)
+                res += (x[i] - y[i])*z[i];
+            return res;
+        }
+        //Scaled sum of squares, as nrm2, so that the squares can neither overflow nor underflow
+        static ScalarType diff_nrm2(size_t N, VectorType const & x, VectorType const & y)
+        {
+            ScalarType scale = 0, ssq = 1;
+            for(size_t i = 0 ; i < N ; ++i){
+                ScalarType d = std::abs(x[i] - y[i]);
+                if(d == 0)
+                    continue;
+                if(scale < d){
+                    ssq = 1 + ssq*(scale/d)*(scale/d);
+                    scale = d;
+                }
+                else
+                    ssq += (d/scale)*(d/scale);
+            }
+            return scale*std::sqrt(ssq);
+        }
         static void symv(size_t N, ScalarType alpha, MatrixType const& A, VectorType const & x, ScalarType beta, VectorType & y)
         { cblas_dsymv(CblasRowMajor,CblasUpper,N,alpha,A,N,x,1,beta,y,1);  }
         static void gemv(size_t M, size_t N, ScalarType alpha, MatrixType const& A, VectorType const & x, ScalarType beta, VectorType & y)
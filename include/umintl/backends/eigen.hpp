@@ -45,6 +45,14 @@ namespace umintl{
         { return x.norm(); }
         static ScalarType dot(size_t /*N*/, VectorType const & x, VectorType const & y)
         { return x.dot(y); }
+        static ScalarType axpy_dot(size_t /*N*/, ScalarType alpha, VectorType const & x, VectorType & y, VectorType const & z)
+        { y = alpha*x + y; return y.dot(z); }
+        static void waxpby(size_t /*N*/, ScalarType alpha, VectorType const & x, ScalarType beta, VectorType const & y, VectorType & w)
+        { w = alpha*x + beta*y; }
+        static ScalarType diff_dot(size_t /*N*/, VectorType const & x, VectorType const & y, VectorType const & z)
+        { return (x - y).dot(z); }
+        static ScalarType diff_nrm2(size_t /*N*/, VectorType const & x, VectorType const & y)
+        { return (x - y).stableNorm(); }
         static void symv(size_t /*N*/, ScalarType alpha, MatrixType const& A, VectorType const & x, ScalarType beta, VectorType & y)
         { y = alpha*A*x + beta*y;  }
         static void gemv(size_t /*M*/, size_t /*N*/, ScalarType alpha, MatrixType const& A, VectorType const & x, ScalarType beta, VectorType & y)
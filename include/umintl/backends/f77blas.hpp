@@ -13,6 +13,7 @@
 
 #include <cstring>
 #include <algorithm>
+#include <cmath>
 
 namespace umintl{
 
@@ -56,7 +57,40 @@ namespace umintl{
         static ScalarType nrm2(size_t N, VectorType const & x)
         { return FORTRAN_WRAPPER(snrm2)(&N,(vec_ref)x,(size_t*)&one_inc); }
         static ScalarType dot(size_t N, VectorType const & x, VectorType const & y)
-        { return FORTRAN_WRAPPER(sdot)(&N,(vec_ref)x,(size_t*)&one_inc,(vec_ref)y,(size_t*)&one_inc); }
+        { return (ScalarType)FORTRAN_WRAPPER(dsdot)(&N,(vec_ref)x,(size_t*)&one_inc,(vec_ref)y,(size_t*)&one_inc); }
+        static void waxpby(size_t N, ScalarType alpha, VectorType const & x, ScalarType beta, VectorType const & y, VectorType & w)
+        {
+            for(size_t i = 0 ; i < N ; ++i)
+                w[i] = alpha*x[i] + beta*y[i];
+        }
+        //Accumulated in double, as dot
+        static ScalarType axpy_dot(size_t N, ScalarType alpha, VectorType const & x, VectorType & y, VectorType const & z)
+        {
+            double res = 0;
+            for(size_t i = 0 ; i < N ; ++i){
+                y[i] += alpha*x[i];
+                res += (double)y[i]*z[i];
+            }
+            return (ScalarType)res;
+        }
+        //Accumulated in double, as dot
+        static ScalarType diff_dot(size_t N, VectorType const & x, VectorType const & y, VectorType const & z)
+        {
+            double res = 0;
+            for(size_t i = 0 ; i < N ; ++i)
+                res += ((double)x[i] - y[i])*z[i];
+            return (ScalarType)res;
+        }
+        //Squares accumulated in double, where they can neither overflow nor underflow
+        static ScalarType diff_nrm2(size_t N, VectorType const & x, VectorType const & y)
+        {
+            double res = 0;
+            for(size_t i = 0 ; i < N ; ++i){
+                double d = (double)x[i] - y[i];
+                res += d*d;
+            }
+            return (ScalarType)std::sqrt(res);
+        }
         static void symv(size_t N, ScalarType alpha, MatrixType const& A, VectorType const & x, ScalarType beta, VectorType & y)
         { FORTRAN_WRAPPER(ssymv)((char*)&Lower,&N,&alpha,A,&N,(vec_ref)x,(size_t*)&one_inc,&beta,y,(size_t*)&one_inc);  }
         static void syr1(size_t N, ScalarType alpha, VectorType const & x, MatrixType & A)
@@ -107,6 +141,44 @@ namespace umintl{
         { return FORTRAN_WRAPPER(dnrm2)(&N,(vec_ref)x,(size_t*)&one_inc); }
         static ScalarType dot(size_t N, VectorType const & x, VectorType const & y)
         { return FORTRAN_WRAPPER(ddot)(&N,(vec_ref)x,(size_t*)&one_inc,(vec_ref)y,(size_t*)&one_inc); }
+        static void waxpby(size_t N, ScalarType alpha, VectorType const & x, ScalarType beta, VectorType const & y, VectorType & w)
+        {
+            for(size_t i = 0 ; i < N ; ++i)
+                w[i] = alpha*x[i] + beta*y[i];
+        }
+        static ScalarType axpy_dot(size_t N, ScalarType alpha, VectorType const & x, VectorType & y, VectorType const & z)
+        {
+            ScalarType res = 0;
+            for(size_t i = 0 ; i < N ; ++i){
+                y[i] += alpha*x[i];
+                res += y[i]*z[i];
+            }
+            return res;
+        }
+        static ScalarType diff_dot(size_t N, VectorType const & x, VectorType const & y, VectorType const & z)
+        {
+            ScalarType res = 0;
+            for(size_t i = 0 ; i < N ; ++i)
+                res += (x[i] - y[i])*z[i];
+            return res;
+        }
+        //Scaled sum of squares, as nrm2, so that the squares can neither overflow nor underflow
+        static ScalarType diff_nrm2(size_t N, VectorType const & x, VectorType const & y)
+        {
+            ScalarType scale = 0, ssq = 1;
+            for(size_t i = 0 ; i < N ; ++i){
+                ScalarType d = std::abs(x[i] - y[i]);
+                if(d == 0)
+                    continue;
+                if(scale < d){
+                    ssq = 1 + ssq*(scale/d)*(scale/d);
+                    scale = d;
+                }
+                else
+                    ssq += (d/scale)*(d/scale);
+            }
+            return scale*std::sqrt(ssq);
+        }
         static void symv(size_t N, ScalarType alpha, MatrixType const& A, VectorType const & x, ScalarType beta, VectorType & y)
         { FORTRAN_WRAPPER(dsymv)((char*)&Lower,&N,&alpha,A,&N,(vec_ref)x,(size_t*)&one_inc,&beta,y,(size_t*)&one_inc);  }
         static void syr1(size_t N, ScalarType alpha, VectorType const & x, MatrixType & A)
@@ -0,0 +1,57 @@
+/* ===========================
+  Copyright (c) 2013 Philippe Tillet
+  UMinTL - Unconstrained Minimization Template Library
+
+  License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef UMINTL_BACKENDS_FUSED_HPP
+#define UMINTL_BACKENDS_FUSED_HPP
+
+#include <cstddef>
+#include <utility>
+
+namespace umintl{
+
+  namespace backend{
+
+    /** @brief Fused vector operations
+     *
+     *  Forwards to the backend, which provides each operation in a single pass over the vectors.
+     */
+    template<class BackendType>
+    struct fused{
+    private:
+        typedef typename BackendType::ScalarType ScalarType;
+        typedef typename BackendType::VectorType VectorType;
+
+    public:
+        /** @brief w = alpha*x + beta*y. w may alias x or y */
+        static void waxpby(size_t N, ScalarType alpha, VectorType const & x, ScalarType beta, VectorType const & y, VectorType & w)
+        { BackendType::waxpby(N,alpha,x,beta,y,w); }
+
+        /** @brief y = y + alpha*x, returns y'z. z may alias x or y */
+        static ScalarType axpy_dot(size_t N, ScalarType alpha, VectorType const & x, VectorType & y, VectorType const & z)
+        { return BackendType::axpy_dot(N,alpha,x,y,z); }
+
+        /** @brief returns z'(x - y) */
+        static ScalarType diff_dot(size_t N, VectorType const & x, VectorType const & y, VectorType const & z)
+        { return BackendType::diff_dot(N,x,y,z); }
+
+        /** @brief returns norm2(x - y) */
+        static ScalarType diff_nrm2(size_t N, VectorType const & x, VectorType const & y)
+        { return BackendType::diff_nrm2(N,x,y); }
+
+        /** @brief exchanges the content of x and y */
+        static void swap(VectorType & x, VectorType & y)
+        {
+            using std::swap;
+            swap(x,y);
+        }
+    };
+
+  }
+
+}
+
+#endif
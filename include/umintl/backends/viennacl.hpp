@@ -50,6 +50,14 @@ namespace umintl{
         { return viennacl::linalg::norm_2(x); }
         static ScalarType dot(size_t /*N*/, VectorType const & x, VectorType const & y)
         { return viennacl::linalg::inner_prod(x,y); }
+        static ScalarType axpy_dot(size_t /*N*/, ScalarType alpha, VectorType const & x, VectorType & y, VectorType const & z)
+        { y = alpha*x + y; return viennacl::linalg::inner_prod(y,z); }
+        static void waxpby(size_t /*N*/, ScalarType alpha, VectorType const & x, ScalarType beta, VectorType const & y, VectorType & w)
+        { w = alpha*x + beta*y; }
+        static ScalarType diff_dot(size_t /*N*/, VectorType const & x, VectorType const & y, VectorType const & z)
+        { return viennacl::linalg::inner_prod(x - y,z); }
+        static ScalarType diff_nrm2(size_t /*N*/, VectorType const & x, VectorType const & y)
+        { return viennacl::linalg::norm_2(x - y); }
         static void symv(size_t /*N*/, ScalarType alpha, MatrixType const& A, VectorType const & x, ScalarType beta, VectorType & y)
         { y = alpha*A*x + beta*y;  }
         static void syr1(size_t /*N*/, ScalarType const & alpha, VectorType const & x, MatrixType & A)
@@ -11,6 +11,7 @@
 #include "umintl/optimization_context.hpp"
 
 #include "umintl/tools/shared_ptr.hpp"
+#include "umintl/backends/fused.hpp"
 #include "umintl/directions/forwards.h"
 
 
@@ -43,12 +44,9 @@ public:
     typedef typename BackendType::ScalarType ScalarType;
 private:
     ScalarType update_polak_ribiere(optimization_context<BackendType> & c){
-        VectorType tmp = BackendType::create_vector(c.N());
-        BackendType::copy(c.N(),c.g(), tmp);
-        BackendType::axpy(c.N(),-1,c.gm1(),tmp);
-        ScalarType res = std::max(BackendType::dot(c.N(),c.g(),tmp)/BackendType::dot(c.N(),c.gm1(),c.gm1()),(ScalarType)0);
-        BackendType::delete_if_dynamically_allocated(tmp);
-        return res;
+        //g'(g - gm1), in one pass and without the cancellation of g'g - g'gm1 when g and gm1 are close
+        ScalarType num = backend::fused<BackendType>::diff_dot(c.N(),c.g(),c.gm1(),c.g());
+        return std::max(num/BackendType::dot(c.N(),c.gm1(),c.gm1()),(ScalarType)0);
     }
 
     ScalarType update_fletcher_reeves(optimization_context<BackendType> & c){
@@ -98,8 +96,8 @@ public:
             beta = 0;
         else
             beta = update_impl(c);
-        BackendType::scale(c.N(),beta,c.p());
-        BackendType::axpy(c.N(),-1,c.g(),c.p());
+        //p = beta*p - g
+        backend::fused<BackendType>::waxpby(c.N(),-1,c.g(),beta,c.p(),c.p());
     }
 
     tag::conjugate_gradient::update update;
@@ -20,6 +20,12 @@ struct direction{
     virtual std::string info() const = 0;
     virtual void init(optimization_context<BackendType> &){ }
     virtual void clean(optimization_context<BackendType> &){ }
+    //Forgets the curvature gathered on the previous iterations, which no longer holds once the objective has changed
+    virtual void reset(optimization_context<BackendType> &){ }
+    //Whether the direction carries its own step length, so that the line search should try alpha = 1 first
+    virtual bool is_scaled() const { return false; }
+    //Whether the direction is built from hessian-vector products rather than from the previous steps
+    virtual bool uses_hessian() const { return false; }
 };
 
 
@@ -15,113 +15,136 @@
 
 #include "umintl/tools/shared_ptr.hpp"
 #include "umintl/optimization_context.hpp"
+#include "umintl/backends/fused.hpp"
 
 #include "forwards.h"
 
 namespace umintl{
 
+/** @brief L-BFGS direction
+ *
+ *  The (s,y) pairs are kept in a circular buffer so that storing a new pair does not move the older ones,
+ *  and 1/(y's) is computed once per pair. The two-loop recursion works in-place on p and fuses each axpy
+ *  with the dot product required by the next step.
+ *  If the objective provides a hessian preconditioner, it is used as the initial inverse hessian instead of
+ *  the usual scaled identity.
+ */
 template<class BackendType>
 struct low_memory_quasi_newton : public direction<BackendType>{
-    low_memory_quasi_newton(unsigned int _m = 4) : m(_m) { }
+    low_memory_quasi_newton(unsigned int _m = 4) : m(_m), use_preconditioner(true), N_(0), tmp_(), n_valid_pairs_(0), head_(0) { }
     unsigned int m;
+    bool use_preconditioner;
 
     typedef typename BackendType::ScalarType ScalarType;
     typedef typename BackendType::VectorType VectorType;
     typedef typename BackendType::MatrixType MatrixType;
 
 private:
+    typedef backend::fused<BackendType> fused;
 
     struct storage_pair{
         VectorType s;
         VectorType y;
+        ScalarType rho;
+        ScalarType alpha;
     };
 
-    VectorType & s(size_t i) { return vecs_[i].s; }
-    VectorType & y(size_t i) { return vecs_[i].y; }
+    //i-th most recent pair (i=0 is the newest)
+    storage_pair & pair(unsigned int i) { return vecs_[(head_ + m - 1 - i)%m]; }
 
 public:
 
     virtual void init(optimization_context<BackendType> & context){
         vecs_.resize(m);
         N_ = context.N();
-        q_ = BackendType::create_vector(N_);
-        r_ = BackendType::create_vector(N_);
         for(unsigned int i = 0 ; i < m ; ++i){
             vecs_[i].s = BackendType::create_vector(N_);
             vecs_[i].y = BackendType::create_vector(N_);
         }
+        tmp_ = BackendType::create_vector(N_);
         n_valid_pairs_ = 0;
+        head_ = 0;
     }
 
     virtual void clean(optimization_context<BackendType> &){
-        BackendType::delete_if_dynamically_allocated(q_);
-        BackendType::delete_if_dynamically_allocated(r_);
         for(unsigned int i = 0 ; i < m ; ++i){
-            BackendType::delete_if_dynamically_allocated(s(i));
-            BackendType::delete_if_dynamically_allocated(y(i));
+            BackendType::delete_if_dynamically_allocated(vecs_[i].s);
+            BackendType::delete_if_dynamically_allocated(vecs_[i].y);
         }
         vecs_.clear();
+        BackendType::delete_if_dynamically_allocated(tmp_);
+    }
+
+    virtual void reset(optimization_context<BackendType> &){
+        n_valid_pairs_ = 0;
     }
 
     virtual std::string info() const{
         return "Low memory quasi-newton";
     }
 
-    void operator()(optimization_context<BackendType> & c){
-        std::vector<ScalarType> rhos(m);
-        std::vector<ScalarType> alphas(m);
+    virtual bool is_scaled() const { return true; }
 
-        //Algorithm
+    void operator()(optimization_context<BackendType> & c){
+        //Overwrites the oldest pair
+        storage_pair & newest = vecs_[head_];
+        head_ = (head_+1)%m;
         n_valid_pairs_ = std::min(n_valid_pairs_+1,m);
 
-        //Updates storage
-        for(unsigned int i = n_valid_pairs_-1 ; i > 0  ; --i){
-            BackendType::copy(N_,s(i-1), s(i));
-            BackendType::copy(N_,y(i-1), y(i));
-        }
+        //s = x - xm1;
+        fused::waxpby(N_,1,c.x(),-1,c.xm1(),newest.s);
 
-        //s(0) = x - xm1;
-        BackendType::copy(N_,c.x(),s(0));
-        BackendType::axpy(N_,-1,c.xm1(),s(0));
+        //y = g - gm1;
+        fused::waxpby(N_,1,c.g(),-1,c.gm1(),newest.y);
 
-        //y(0) = g - gm1;
-        BackendType::copy(N_,c.g(),y(0));
-        BackendType::axpy(N_,-1,c.gm1(),y(0));
+        ScalarType ys = BackendType::dot(N_,newest.y,newest.s);
+        newest.rho = static_cast<ScalarType>(1)/ys;
+        ScalarType scale = ys/BackendType::dot(N_,newest.y,newest.y);
 
+        //The recursion is linear, so it is run directly on p = -g
+        VectorType & p = c.p();
+        fused::waxpby(N_,-1,c.g(),0,c.g(),p);
 
-        BackendType::copy(N_,c.g(),q_);
-        int i = 0;
-        for(; i < (int)n_valid_pairs_ ; ++i){
-            rhos[i] = static_cast<ScalarType>(1)/BackendType::dot(N_,y(i),s(i));
-            alphas[i] = rhos[i]*BackendType::dot(N_,s(i),q_);
-            //q_ = q - alphas[i]*y(i);
-            BackendType::axpy(N_,-alphas[i],y(i),q_);
+        unsigned int n = n_valid_pairs_;
+        ScalarType sq = BackendType::dot(N_,pair(0).s,p);
+        for(unsigned int i = 0 ; i < n ; ++i){
+            storage_pair & pi = pair(i);
+            pi.alpha = pi.rho*sq;
+            //p = p - alpha*y(i) ; sq = s(i+1)'p (or y(n-1)'p for the second loop)
+            VectorType const & next = (i+1<n)?pair(i+1).s:pi.y;
+            sq = fused::axpy_dot(N_,-pi.alpha,pi.y,p,next);
         }
-        ScalarType scale = BackendType::dot(N_,s(0),y(0))/BackendType::dot(N_,y(0),y(0));
-
-        //r_ = scale*q_;
-        BackendType::copy(N_,q_,r_);
-        BackendType::scale(N_,scale,r_);
 
-        --i;
-        for(; i >=0 ; --i){
-            ScalarType beta = rhos[i]*BackendType::dot(N_,y(i),r_);
-            //r_ = r_ + (alphas[i]-beta)*s(i)
-            BackendType::axpy(N_,alphas[i]-beta,s(i),r_);
+        //p = H0*p;
+        ScalarType yr;
+        if(use_preconditioner && c.fun().has_hessian_preconditioner()){
+            value_gradient tag = c.model().get_value_gradient_tag();
+            c.fun().compute_hessian_preconditioner(c.x(),p,tmp_,hessian_preconditioner(tag.model,tag.sample_size,tag.offset,tag.blocks));
+            BackendType::copy(N_,tmp_,p);
+            yr = BackendType::dot(N_,pair(n-1).y,p);
+        }
+        else{
+            BackendType::scale(N_,scale,p);
+            yr = scale*sq;
+        }
+        for(int i = (int)n-1 ; i >= 0 ; --i){
+            storage_pair & pi = pair(i);
+            ScalarType beta = pi.rho*yr;
+            //p = p + (alpha(i)-beta)*s(i) ; yr = y(i-1)'p
+            if(i>0)
+                yr = fused::axpy_dot(N_,pi.alpha-beta,pi.s,p,pair(i-1).y);
+            else
+                BackendType::axpy(N_,pi.alpha-beta,pi.s,p);
         }
-
-        //p = -r_;
-        BackendType::copy(N_,r_,c.p());
-        BackendType::scale(N_,-1,c.p());
     }
 
 private:
 
     size_t N_;
-    VectorType q_;
-    VectorType r_;
+    VectorType tmp_;
     std::vector<storage_pair> vecs_;
     unsigned int n_valid_pairs_;
+    unsigned int head_;
 };
 
 }
@@ -15,6 +15,7 @@
 
 #include "umintl/tools/shared_ptr.hpp"
 #include "umintl/optimization_context.hpp"
+#include "umintl/backends/fused.hpp"
 
 #include "forwards.h"
 
@@ -32,6 +33,8 @@ struct quasi_newton : public direction<BackendType>{
         return "Quasi-Newton";
     }
 
+    virtual bool is_scaled() const { return true; }
+
     virtual void init(optimization_context<BackendType> & c)
     {
         reinitialize_ = true;
@@ -47,6 +50,10 @@ struct quasi_newton : public direction<BackendType>{
         BackendType::set_to_value(y_,0,N_);
     }
 
+    virtual void reset(optimization_context<BackendType> &){
+        reinitialize_ = true;
+    }
+
     virtual void clean(optimization_context<BackendType> &)
     {
         BackendType::delete_if_dynamically_allocated(Hy_);
@@ -58,12 +65,10 @@ struct quasi_newton : public direction<BackendType>{
 
     void operator()(optimization_context<BackendType> & c){
       //s = x - xm1;
-      BackendType::copy(N_,c.x(),s_);
-      BackendType::axpy(N_,-1,c.xm1(),s_);
+      backend::fused<BackendType>::waxpby(N_,1,c.x(),-1,c.xm1(),s_);
 
       //y = g - gm1;
-      BackendType::copy(N_,c.g(),y_);
-      BackendType::axpy(N_,-1,c.gm1(),y_);
+      backend::fused<BackendType>::waxpby(N_,1,c.g(),-1,c.gm1(),y_);
 
       ScalarType ys = BackendType::dot(N_,s_,y_);
 
@@ -12,6 +12,7 @@
 #include "umintl/optimization_context.hpp"
 
 #include "umintl/tools/shared_ptr.hpp"
+#include "umintl/backends/fused.hpp"
 #include "umintl/directions/forwards.h"
 
 
@@ -26,8 +27,8 @@ struct steepest_descent : public direction<BackendType>{
 
     void operator()(optimization_context<BackendType> & c){
         size_t N = c.N();
-        BackendType::copy(N,c.g(),c.p());
-        BackendType::scale(N,-1,c.p());
+        //p = -g
+        backend::fused<BackendType>::waxpby(N,-1,c.g(),0,c.g(),c.p());
     }
 };
 
@@ -13,6 +13,7 @@
 #include <cmath>
 
 #include "umintl/linear/conjugate_gradient.hpp"
+#include "umintl/backends/fused.hpp"
 #include "umintl/tools/shared_ptr.hpp"
 #include "forwards.h"
 
@@ -52,6 +53,18 @@ struct truncated_newton : public direction<BackendType>{
         umintl::detail::function_wrapper<BackendType> & fun_;
     };
 
+    struct compute_Mr: public linear::conjugate_gradient_detail::preconditioner<BackendType>{
+        compute_Mr(VectorType const & x, model_base<BackendType> const & model, umintl::detail::function_wrapper<BackendType> & fun) : x_(x), model_(model), fun_(fun){ }
+        virtual void operator()(size_t, typename BackendType::VectorType const & r, typename BackendType::VectorType & res){
+          hessian_vector_product const & tag = model_.get_hv_product_tag();
+          fun_.compute_hessian_preconditioner(x_,r,res,hessian_preconditioner(tag.model,tag.sample_size,tag.offset,tag.blocks));
+        }
+      protected:
+        VectorType const & x_;
+        model_base<BackendType> const & model_;
+        umintl::detail::function_wrapper<BackendType> & fun_;
+    };
+
     struct variance_stop_criterion : public linear::conjugate_gradient_detail::stopping_criterion<BackendType>{
       private:
         typedef typename BackendType::VectorType VectorType;
@@ -64,9 +77,9 @@ struct truncated_newton : public direction<BackendType>{
         void init(VectorType const & p0){
           VectorType var = BackendType::create_vector(c_.N());
 
-          size_t H = c_.model().get_hv_product_tag().sample_size;
-          size_t offset = c_.model().get_hv_product_tag().offset;
-          c_.fun().compute_hv_product_variance(c_.x(),p0,var,hv_product_variance(STOCHASTIC,H,offset));
+          hessian_vector_product tag = c_.model().get_hv_product_tag();
+          size_t H = tag.sample_size;
+          c_.fun().compute_hv_product_variance(c_.x(),p0,var,hv_product_variance(STOCHASTIC,H,tag.offset,tag.blocks));
           ScalarType nrm2p0 = BackendType::nrm2(c_.N(),p0);
           ScalarType nrm1var = BackendType::asum(c_.N(),var);
           gamma_ = nrm1var/(H*std::pow(nrm2p0,2));
@@ -89,27 +102,33 @@ struct truncated_newton : public direction<BackendType>{
     };
 
   public:
-    truncated_newton(tag::truncated_newton::stopping_criterion _stop = tag::truncated_newton::STOP_RESIDUAL_TOLERANCE, size_t _iter = 0) : iter(_iter), stop(_stop){ }
+    truncated_newton(tag::truncated_newton::stopping_criterion _stop = tag::truncated_newton::STOP_RESIDUAL_TOLERANCE, size_t _iter = 0) : iter(_iter), stop(_stop), use_preconditioner(true){ }
 
     virtual std::string info() const{
         return "Truncated Newton";
     }
 
+    virtual bool is_scaled() const { return true; }
+
+    virtual bool uses_hessian() const { return true; }
+
     void operator()(optimization_context<BackendType> & c){
       if(iter==0) iter = c.N();
 
       linear::conjugate_gradient<BackendType> solver(iter, new compute_Ab(c.x(), c.g(),c.model(),c.fun()));
       if(stop==tag::truncated_newton::STOP_RESIDUAL_TOLERANCE){
-          ScalarType tol = std::min((ScalarType)0.5,std::sqrt(BackendType::nrm2(c.N(),c.g())))*BackendType::nrm2(c.N(),c.g());
+          ScalarType nrm2g = BackendType::nrm2(c.N(),c.g());
+          ScalarType tol = std::min((ScalarType)0.5,std::sqrt(nrm2g))*nrm2g;
           solver.stop = new linear::conjugate_gradient_detail::residual_norm<BackendType>(tol);
       }
       else{
           solver.stop = new variance_stop_criterion(c);
       }
+      if(use_preconditioner && c.fun().has_hessian_preconditioner())
+          solver.precond = new compute_Mr(c.x(),c.model(),c.fun());
 
       VectorType minus_g = BackendType::create_vector(c.N());
-      BackendType::copy(c.N(),c.g(),minus_g);
-      BackendType::scale(c.N(),-1,minus_g);
+      backend::fused<BackendType>::waxpby(c.N(),-1,c.g(),0,c.g(),minus_g);
       BackendType::scale(c.N(),c.alpha(),c.p());
 
 
@@ -123,6 +142,8 @@ struct truncated_newton : public direction<BackendType>{
 
     size_t iter;
     tag::truncated_newton::stopping_criterion stop;
+    /** @brief Uses the preconditioner of the objective, if it provides one */
+    bool use_preconditioner;
 };
 
 }
@@ -1,7 +1,9 @@
 #ifndef UMINTL_FORWARDS_H
 #define UMINTL_FORWARDS_H
 
+#include <algorithm>
 #include <cstddef>
+#include <vector>
 #include "umintl/tools/shared_ptr.hpp"
 
 namespace umintl{
@@ -16,25 +18,50 @@ enum computation_type{ CENTERED_DIFFERENCE, FORWARD_DIFFERENCE, PROVIDED };
 
 enum model_type_tag {  DETERMINISTIC, STOCHASTIC };
 
+/** @brief Partition of a dataset in blocks of block_size consecutive points, visited in the given order
+ *
+ *  When an operation tag refers to a block schedule, its offset and sample_size index the virtual dataset obtained
+ *  by concatenating the blocks order[0], order[1], ... rather than the data itself. The points after the last full
+ *  block of the dataset form a shorter block, which can only be scheduled last.
+ */
+struct block_schedule {
+    block_schedule(size_t _block_size, std::vector<size_t> const & _order, size_t _dataset_size = 0) : block_size(_block_size), order(_order), dataset_size(_dataset_size){ }
+    /* Number of points of the concatenation */
+    size_t size() const {
+        if(order.empty())
+            return 0;
+        return (order.size() - 1)*block_size + std::min(block_size, dataset_size - order.back()*block_size);
+    }
+    size_t block_size;
+    std::vector<size_t> order;
+    size_t dataset_size;
+};
+
 struct operation_tag {
-    operation_tag(model_type_tag const & _model, size_t _sample_size, size_t _offset) : model(_model), sample_size(_sample_size), offset(_offset){ }
+    operation_tag(model_type_tag const & _model, size_t _sample_size, size_t _offset, block_schedule const * _blocks = NULL) : model(_model), sample_size(_sample_size), offset(_offset), blocks(_blocks){ }
     model_type_tag model;
     size_t sample_size;
     size_t offset;
+    block_schedule const * blocks;
 };
 
 struct value_gradient : public operation_tag {
-    value_gradient(model_type_tag const & _model, size_t _sample_size, size_t _offset) : operation_tag(_model,_sample_size,_offset){ }
+    value_gradient(model_type_tag const & _model, size_t _sample_size, size_t _offset, block_schedule const * _blocks = NULL) : operation_tag(_model,_sample_size,_offset,_blocks){ }
 };
 struct hessian_vector_product : public operation_tag {
-    hessian_vector_product(model_type_tag const & _model, size_t _sample_size, size_t _offset) : operation_tag(_model,_sample_size,_offset){ }
+    hessian_vector_product(model_type_tag const & _model, size_t _sample_size, size_t _offset, block_schedule const * _blocks = NULL) : operation_tag(_model,_sample_size,_offset,_blocks){ }
 };
 struct gradient_variance : public operation_tag {
-    gradient_variance(model_type_tag const & _model, size_t _sample_size, size_t _offset) : operation_tag(_model,_sample_size,_offset){ }
+    gradient_variance(model_type_tag const & _model, size_t _sample_size, size_t _offset, block_schedule const * _blocks = NULL) : operation_tag(_model,_sample_size,_offset,_blocks){ }
 };
 struct hv_product_variance : public operation_tag {
-    hv_product_variance(model_type_tag const & _model, size_t _sample_size, size_t _offset) : operation_tag(_model,_sample_size,_offset){ }
+    hv_product_variance(model_type_tag const & _model, size_t _sample_size, size_t _offset, block_schedule const * _blocks = NULL) : operation_tag(_model,_sample_size,_offset,_blocks){ }
+};
+struct hessian_preconditioner : public operation_tag {
+    hessian_preconditioner(model_type_tag const & _model, size_t _sample_size, size_t _offset, block_schedule const * _blocks = NULL) : operation_tag(_model,_sample_size,_offset,_blocks){ }
 };
+struct rebase { };
+struct objective_update { };
 
 }
 #endif
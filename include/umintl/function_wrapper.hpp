@@ -13,6 +13,7 @@
 #include "tools/exception.hpp"
 
 #include "umintl/forwards.h"
+#include "umintl/backends/fused.hpp"
 
 
 #include <iostream>
@@ -40,6 +41,12 @@ namespace umintl{
             virtual void compute_hv_product(VectorType const & x, VectorType const & g, VectorType const & v, VectorType & Hv, hessian_vector_product const & tag) = 0;
             virtual void compute_gradient_variance(VectorType const & x, VectorType & variance, gradient_variance const & tag) = 0;
             virtual void compute_hv_product_variance(VectorType const & x, VectorType const & v, VectorType & variance, hv_product_variance const & tag) = 0;
+            virtual bool has_hessian_preconditioner() const = 0;
+            virtual void compute_hessian_preconditioner(VectorType const & x, VectorType const & r, VectorType & z, hessian_preconditioner const & tag) = 0;
+            virtual bool has_rebase() const = 0;
+            virtual void rebase(VectorType const & x) = 0;
+            virtual bool has_objective_update() const = 0;
+            virtual bool update_objective(VectorType const & x) = 0;
             virtual ~function_wrapper(){ }
         };
 
@@ -105,6 +112,39 @@ namespace umintl{
                 fun_(x,v,Hv,tag);
             }
 
+            //Apply the inverse of an approximation of the hessian
+            void operator()(VectorType const &, VectorType const &, VectorType&, hessian_preconditioner const &, int2type<false>){
+                throw exceptions::incompatible_parameters(
+                            "\n"
+                            "No hessian preconditioner supplied!"
+                            "Please provide an overload of :\n"
+                            "void operator()(VectorType const & X, VectorType const & r, VectorType & z, umintl::hessian_preconditioner)\n."
+                            );
+            }
+            void operator()(VectorType const & x, VectorType const & r, VectorType& z, hessian_preconditioner const & tag, int2type<true>){
+                fun_(x,r,z,tag);
+            }
+
+            //Move the origin of the parametrization to x
+            void operator()(VectorType const &, umintl::rebase const &, int2type<false>){
+                throw exceptions::incompatible_parameters(
+                            "\n"
+                            "Please provide an overload of :\n"
+                            "void operator()(VectorType const & X, umintl::rebase)\n."
+                            );
+            }
+            void operator()(VectorType const & x, umintl::rebase const & tag, int2type<true>){
+                fun_(x,tag);
+            }
+
+            //Adapt the objective to the accepted iterate x
+            bool operator()(VectorType const &, umintl::objective_update const &, int2type<false>){
+                return false;
+            }
+            bool operator()(VectorType const & x, umintl::objective_update const & tag, int2type<true>){
+                return fun_(x,tag);
+            }
+
         public:
             function_wrapper_impl(Fun & fun, size_t N, computation_type hessian_vector_product_computation) : fun_(fun), N_(N), hessian_vector_product_computation_(hessian_vector_product_computation){
               n_value_computations_ = 0;
@@ -130,7 +170,7 @@ namespace umintl{
             }
 
             void compute_hv_product(VectorType const & x, VectorType const & g, VectorType const & v, VectorType & Hv, hessian_vector_product const & tag){
-              value_gradient vgtag(tag.model, tag.sample_size, tag.offset);
+              value_gradient vgtag(tag.model, tag.sample_size, tag.offset, tag.blocks);
               switch(hessian_vector_product_computation_){
                 case umintl::CENTERED_DIFFERENCE:
                 {
@@ -140,19 +180,15 @@ namespace umintl{
                   ScalarType h = (ScalarType)1e-7;
 
                   //Hv = Grad(x+hb)
-                  BackendType::copy(N_,x,tmp); //tmp = x + hb
-                  BackendType::axpy(N_,h,v,tmp);
+                  backend::fused<BackendType>::waxpby(N_,1,x,h,v,tmp); //tmp = x + hb
                    (*this)(tmp,dummy,Hv,vgtag,int2type<is_call_possible<Fun,void(VectorType const &, ScalarType&, VectorType&, value_gradient)>::value>());
 
                   //Hvleft = Grad(x-hb)
-                  BackendType::copy(N_,x,tmp); //tmp = x - hb
-                  BackendType::axpy(N_,-h,v,tmp);
+                  backend::fused<BackendType>::waxpby(N_,1,x,-h,v,tmp); //tmp = x - hb
                   (*this)(tmp,dummy,Hvleft,vgtag,int2type<is_call_possible<Fun,void(VectorType const &, ScalarType&, VectorType&, value_gradient)>::value>());
 
-                  //Hv-=Hvleft
-                  //Hv/=2h
-                  BackendType::axpy(N_,-1,Hvleft,Hv);
-                  BackendType::scale(N_,1/(2*h),Hv);
+                  //Hv = (Hv - Hvleft)/2h
+                  backend::fused<BackendType>::waxpby(N_,1/(2*h),Hv,-1/(2*h),Hvleft,Hv);
 
                   BackendType::delete_if_dynamically_allocated(tmp);
                   BackendType::delete_if_dynamically_allocated(Hvleft);
@@ -164,11 +200,9 @@ namespace umintl{
                   VectorType tmp = BackendType::create_vector(N_);
                   ScalarType h = (ScalarType)1e-7;
 
-                  BackendType::copy(N_,x,tmp); //tmp = x + hb
-                  BackendType::axpy(N_,h,v,tmp);
+                  backend::fused<BackendType>::waxpby(N_,1,x,h,v,tmp); //tmp = x + hb
                   (*this)(tmp,dummy,Hv,vgtag,int2type<is_call_possible<Fun,void(VectorType const &, ScalarType&, VectorType&, value_gradient)>::value>());
-                  BackendType::axpy(N_,-1,g,Hv);
-                  BackendType::scale(N_,1/h,Hv);
+                  backend::fused<BackendType>::waxpby(N_,1/h,Hv,-1/h,g,Hv); //Hv = (Hv - g)/h
 
                   BackendType::delete_if_dynamically_allocated(tmp);
                   break;
@@ -189,6 +223,30 @@ namespace umintl{
               (*this)(x,v,variance,tag,int2type<is_call_possible<Fun,void(VectorType const &, VectorType const &, VectorType &,hv_product_variance)>::value>());
             }
 
+            bool has_hessian_preconditioner() const{
+              return is_call_possible<Fun,void(VectorType const &, VectorType const &, VectorType &,hessian_preconditioner)>::value;
+            }
+
+            void compute_hessian_preconditioner(VectorType const & x, VectorType const & r, VectorType & z, hessian_preconditioner const & tag){
+              (*this)(x,r,z,tag,int2type<is_call_possible<Fun,void(VectorType const &, VectorType const &, VectorType &,hessian_preconditioner)>::value>());
+            }
+
+            bool has_rebase() const{
+              return is_call_possible<Fun,void(VectorType const &, umintl::rebase)>::value;
+            }
+
+            void rebase(VectorType const & x){
+              (*this)(x,umintl::rebase(),int2type<is_call_possible<Fun,void(VectorType const &, umintl::rebase)>::value>());
+            }
+
+            bool has_objective_update() const{
+              return is_call_possible<Fun,bool(VectorType const &, umintl::objective_update)>::value;
+            }
+
+            bool update_objective(VectorType const & x){
+              return (*this)(x,umintl::objective_update(),int2type<is_call_possible<Fun,bool(VectorType const &, umintl::objective_update)>::value>());
+            }
+
           private:
             Fun & fun_;
             size_t N_;
@@ -0,0 +1,61 @@
+/* ===========================
+  Copyright (c) 2013 Philippe Tillet
+  UMinTL - Unconstrained Minimization Template Library
+
+  License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef UMINTL_LINE_SEARCH_BACKTRACKING_HPP_
+#define UMINTL_LINE_SEARCH_BACKTRACKING_HPP_
+
+#include "umintl/optimization_context.hpp"
+#include "umintl/backends/fused.hpp"
+#include "forwards.h"
+
+namespace umintl{
+
+/** @brief The backtracking line-search class
+ *
+ *  Starts from the unit step and shrinks it until the Armijo condition holds. Only the value at the trial points
+ *  is tested, which makes it suitable for objectives whose gradient is only exact at the origin (see umintl::rebase).
+ *  @tparam BackendType the linear algebra backend of the minimizer
+ */
+template<class BackendType>
+struct backtracking : public line_search<BackendType>{
+    typedef typename BackendType::ScalarType ScalarType;
+    typedef typename BackendType::VectorType VectorType;
+
+    /** @brief The constructor
+     *  @param _max_evals maximum number of value-gradient evaluation in the line-search
+     *  @param _c1 parameter of the Armijo condition
+     *  @param _shrink factor applied to the step after each failure
+     */
+    backtracking(unsigned int _max_evals = 10, ScalarType _c1 = 1e-4, ScalarType _shrink = 0.5) : line_search<BackendType>(_max_evals), c1(_c1), shrink(_shrink) { }
+
+    void operator()(line_search_result<BackendType> & res, umintl::direction<BackendType> *, optimization_context<BackendType> & c) {
+        ScalarType alpha = 1;
+        for(unsigned int i = 0 ; i < max_evals ; ++i){
+            //Compute phi(alpha) = f(x0 + alpha*p)
+            backend::fused<BackendType>::waxpby(c.N(),1,c.x(),alpha,c.p(),res.best_x);
+            c.fun().compute_value_gradient(res.best_x,res.best_phi,res.best_g,c.model().get_value_gradient_tag());
+            if(res.best_phi <= c.val() + c1*alpha*c.dphi_0()){
+                res.best_alpha = alpha;
+                res.has_failed = false;
+                return;
+            }
+            alpha*=shrink;
+        }
+        res.best_alpha = alpha;
+        res.has_failed = true;
+    }
+
+    ScalarType c1;
+    ScalarType shrink;
+
+private:
+    using line_search<BackendType>::max_evals;
+};
+
+}
+
+#endif
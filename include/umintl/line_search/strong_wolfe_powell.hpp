@@ -15,6 +15,7 @@
 
 
 #include "umintl/optimization_context.hpp"
+#include "umintl/backends/fused.hpp"
 #include "forwards.h"
 
 #include <cmath>
@@ -32,23 +33,12 @@ struct strong_wolfe_powell : public line_search<BackendType>{
     /** @brief The constructor
      *  @param _max_evals maximum number of value-gradient evaluation in the line-search
      */
-    strong_wolfe_powell(unsigned int _max_evals = 40) : line_search<BackendType>(_max_evals) { }
+    strong_wolfe_powell(unsigned int _max_evals = 40) : line_search<BackendType>(_max_evals), c1_(1e-4), c2_(0.9) { }
 
     typedef typename BackendType::ScalarType ScalarType;
     typedef typename BackendType::VectorType VectorType;
     typedef typename BackendType::MatrixType MatrixType;
 
-    /** @brief initialization of the temporaries */
-    virtual void init(optimization_context<BackendType> & c){
-        x0_ = BackendType::create_vector(c.N());
-    }
-
-    /** @brief deletion of the temporaries */
-    virtual void clean(optimization_context<BackendType> &){
-        BackendType::delete_if_dynamically_allocated(x0_);
-    }
-
-
 private:
     using line_search<BackendType>::max_evals;
 
@@ -102,8 +92,7 @@ private:
             }
 
             //Compute phi(alpha) = f(x0 + alpha*p)
-            BackendType::copy(c.N(),x0_,current_x);
-            BackendType::axpy(c.N(),alpha,p,current_x);
+            backend::fused<BackendType>::waxpby(c.N(),1,c.x(),alpha,p,current_x);
             c.fun().compute_value_gradient(current_x,current_phi,current_g,c.model().get_value_gradient_tag());
             dphi = BackendType::dot(c.N(),current_g,p);
 
@@ -144,7 +133,7 @@ public:
     void operator()(line_search_result<BackendType> & res, umintl::direction<BackendType> * direction, optimization_context<BackendType> & c) {
         ScalarType alpha;
         c1_ = (ScalarType)1e-4;
-        if(dynamic_cast<conjugate_gradient<BackendType>* >(direction) || dynamic_cast<steepest_descent<BackendType>* >(direction)){
+        if(!direction->is_scaled()){
             c2_ = (ScalarType)0.2;
             alpha = std::min((ScalarType)(1.0),1/BackendType::asum(c.N(),c.g()));
         }
@@ -166,13 +155,10 @@ public:
         VectorType & current_g = res.best_g;
         VectorType const & p = c.p();
 
-        BackendType::copy(c.N(),c.x(), x0_);
-
-
+        //c.x() is left untouched during the search and serves as x0
         for(unsigned int i = 1 ; i< max_evals; ++i){
             //Compute phi(alpha) = f(x0 + alpha*p) ; dphi = grad(phi)_alpha'*p
-            BackendType::copy(c.N(),x0_,current_x);
-            BackendType::axpy(c.N(),alpha,p,current_x);
+            backend::fused<BackendType>::waxpby(c.N(),1,c.x(),alpha,p,current_x);
             c.fun().compute_value_gradient(current_x,current_phi,current_g,c.model().get_value_gradient_tag());
             dphi = BackendType::dot(c.N(),current_g,p);
 
@@ -216,8 +202,6 @@ private:
     ScalarType c1_;
     /** parameter of the strong-wolfe powell conditions */
     ScalarType c2_;
-    /** temporary vector */
-    VectorType x0_;
 
 
 };
@@ -12,6 +12,7 @@
 #include <cmath>
 
 #include "umintl/tools/shared_ptr.hpp"
+#include "umintl/backends/fused.hpp"
 
 namespace umintl{
 
@@ -77,13 +78,24 @@ namespace umintl{
           MatrixType const & A_;
       };
 
+      /** @brief Base class for a preconditioner within linear conjugate gradient
+      *
+      * Computes res = M^-1 r, where M is a symmetric positive definite approximation of the matrix of the system
+      */
+      template<class BackendType>
+      struct preconditioner{
+          virtual ~preconditioner(){ }
+          virtual void operator()(size_t N, typename BackendType::VectorType const & r, typename BackendType::VectorType & res) = 0;
+      };
+
 
     }
 
     /** @brief Base class for the linear conjugate gradient
     *
     * This is a slightly modified version of the CG algorithm. Indeed,
-    * the procedure is stopped whenever a direction of neative curvature is found
+    * the procedure is stopped whenever a direction of neative curvature is found.
+    * When a preconditioner is supplied, the preconditioned variant of the algorithm is used.
     */
     template<class BackendType>
     struct conjugate_gradient{
@@ -91,6 +103,7 @@ namespace umintl{
         typedef typename BackendType::MatrixType MatrixType;
         typedef typename BackendType::VectorType VectorType;
         typedef typename BackendType::ScalarType ScalarType;
+        typedef backend::fused<BackendType> fused;
       public:
         enum return_code{
           SUCCESS,
@@ -109,6 +122,8 @@ namespace umintl{
           r = BackendType::create_vector(N);
           p = BackendType::create_vector(N);
           Ap = BackendType::create_vector(N);
+          if(precond.get())
+            z = BackendType::create_vector(N);
         }
 
         optimization_result clear_terminate(return_code ret, size_t i){
@@ -116,6 +131,8 @@ namespace umintl{
           BackendType::delete_if_dynamically_allocated(r);
           BackendType::delete_if_dynamically_allocated(p);
           BackendType::delete_if_dynamically_allocated(Ap);
+          if(precond.get())
+            BackendType::delete_if_dynamically_allocated(z);
           optimization_result res;
           res.ret = ret;
           res.i = i;
@@ -147,20 +164,23 @@ namespace umintl{
           else{
             //r = b - Ax0
             (*compute_Ab)(N,x,r); //r = Ax
-            BackendType::scale(N,-1,r); //r = -Ax
-            BackendType::axpy(N,1,b,r); //r = b - Ax
+            fused::waxpby(N,1,b,-1,r,r); //r = b - Ax
           }
 
-          //p = r;
-          BackendType::copy(N,r,p);
+          //p = M^-1 r;
+          if(precond.get())
+            (*precond)(N,r,p);
+          else
+            BackendType::copy(N,r,p);
 
           stop->init(p);
 
-          ScalarType rso = BackendType::dot(N,r,r);
+          ScalarType rso = BackendType::dot(N,r,p);
 
           for(size_t i = 0 ; i < iter ; ++i){
             (*compute_Ab)(N,p,Ap);
-            BackendType::axpy(N,lambda*nrm_b,b,Ap);
+            if(lambda!=0)
+              BackendType::axpy(N,lambda*nrm_b,b,Ap);
 
 
              //Ap = A*p
@@ -175,20 +195,25 @@ namespace umintl{
 
             ScalarType alpha = rso/pAp; //alpha = rso/(p'*Ap)
             BackendType::axpy(N,alpha,p,x); //x = x + alpha*p
-            BackendType::axpy(N,-alpha,Ap,r); //r = r - alpha*Ap
+            ScalarType rsn = fused::axpy_dot(N,-alpha,Ap,r,r); //r = r - alpha*Ap ; rsn = r'r
 
             stop->update(x);
 
             //ScalarType quadval = -0.5*(BackendType::dot(N,x,r) + BackendType::dot(N,x,b)); //quadval = -0.5*(x'r + x'b);
 
-            ScalarType rsn = BackendType::dot(N,r,r);
-
             if((*stop)(rsn))
               return clear_terminate(SUCCESS,i);
 
-            BackendType::scale(N,rsn/rso,p);//pk = r + rsn/rso*pk
-            BackendType::axpy(N,1,r,p);
-            rso = rsn;
+            if(precond.get()){
+              (*precond)(N,r,z); //z = M^-1 r
+              ScalarType rzn = BackendType::dot(N,r,z);
+              fused::waxpby(N,1,z,rzn/rso,p,p);//pk = z + rzn/rzo*pk
+              rso = rzn;
+            }
+            else{
+              fused::waxpby(N,1,r,rsn/rso,p,p);//pk = r + rsn/rso*pk
+              rso = rsn;
+            }
           }
           return clear_terminate(FAILURE,iter);
         }
@@ -196,7 +221,9 @@ namespace umintl{
         size_t iter;
         tools::shared_ptr<linear::conjugate_gradient_detail::compute_Ab<BackendType> > compute_Ab;
         tools::shared_ptr<linear::conjugate_gradient_detail::stopping_criterion<BackendType> > stop;
+        tools::shared_ptr<linear::conjugate_gradient_detail::preconditioner<BackendType> > precond;
       private:
+        VectorType z;
         VectorType r;
         VectorType p;
         VectorType Ap;
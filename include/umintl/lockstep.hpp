@@ -0,0 +1,335 @@
+/* ===========================
+  Copyright (c) 2013 Philippe Tillet
+  UMinTL - Unconstrained Minimization Template Library
+
+  License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef UMINTL_LOCKSTEP_HPP_
+#define UMINTL_LOCKSTEP_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "umintl/forwards.h"
+#include "umintl/function_wrapper.hpp"
+#include "umintl/optimization_result.hpp"
+
+namespace umintl{
+
+/** @brief L-BFGS with a backtracking line-search, advancing P independent problems of the same size N in lockstep
+ *
+ *  Meant for problems so small that the BLAS calls and the dispatch of umintl::minimizer cost more than the arithmetic.
+ *  The vectors of the P problems are interleaved, x[i*P + k] being the i-th variable of the k-th problem, so that each
+ *  vector operation is one loop over the problems nested in a loop over the variables, and each dot product fills P
+ *  accumulators at once. The iterations are the ones of umintl::minimizer with low_memory_quasi_newton and backtracking,
+ *  with a step, curvature pairs and a termination per problem. A problem that is done is masked out of the evaluations.
+ *
+ *  The objective evaluates, at once, the problems whose mask is non-zero :
+ *    void operator()(ScalarType const * x, ScalarType * values, ScalarType * grads, unsigned char const * mask)
+ *  and may provide, with the same meaning as for umintl::minimizer (the tags are full-batch) :
+ *    void operator()(ScalarType const * x, ScalarType const * r, ScalarType * z, unsigned char const * mask, umintl::hessian_preconditioner)
+ *    void operator()(ScalarType const * x, unsigned char const * mask, umintl::rebase)
+ *    void operator()(ScalarType const * x, unsigned char const * mask, unsigned char * updated, umintl::objective_update)
+ *  the latter setting updated[k] to whether the objective of the k-th problem has changed. As in umintl::minimizer, the
+ *  value and gradient of such a problem are then recomputed, it forgets its curvature pairs and its next step is a
+ *  steepest descent one.
+ */
+template<class ScalarType>
+class lockstep_minimizer{
+    typedef unsigned char mask_type;
+
+    //res[k] = a(k)'b(k)
+    static void dot(size_t N, size_t P, ScalarType const * a, ScalarType const * b, ScalarType * res){
+        std::fill(res, res + P, (ScalarType)0);
+        for(size_t i = 0 ; i < N ; ++i)
+            for(size_t k = 0 ; k < P ; ++k)
+                res[k] += a[i*P+k]*b[i*P+k];
+    }
+
+    //y(k) = y(k) + alpha[k]*x(k)
+    static void axpy(size_t N, size_t P, ScalarType const * alpha, ScalarType const * x, ScalarType * y){
+        for(size_t i = 0 ; i < N ; ++i)
+            for(size_t k = 0 ; k < P ; ++k)
+                y[i*P+k] += alpha[k]*x[i*P+k];
+    }
+
+    //z(k) = x(k) - y(k)
+    static void sub(size_t N, size_t P, ScalarType const * x, ScalarType const * y, ScalarType * z){
+        for(size_t i = 0 ; i < N*P ; ++i)
+            z[i] = x[i] - y[i];
+    }
+
+    //y(k) = x(k) where mask[k]
+    static void select(size_t N, size_t P, mask_type const * mask, ScalarType const * x, ScalarType * y){
+        for(size_t i = 0 ; i < N ; ++i)
+            for(size_t k = 0 ; k < P ; ++k)
+                y[i*P+k] = mask[k]?x[i*P+k]:y[i*P+k];
+    }
+
+    template<class Fun>
+    void precondition(Fun & fun, ScalarType const * x, ScalarType const * r, ScalarType * z, mask_type const * mask, detail::int2type<true>){
+        fun(x, r, z, mask, hessian_preconditioner(DETERMINISTIC, 0, 0));
+    }
+
+    template<class Fun>
+    void precondition(Fun &, ScalarType const *, ScalarType const *, ScalarType *, mask_type const *, detail::int2type<false>){ }
+
+    template<class Fun>
+    void rebase(Fun & fun, ScalarType * x, ScalarType * xm1, size_t N, size_t P, mask_type const * mask, detail::int2type<true>){
+        fun((ScalarType const *)x, mask, umintl::rebase());
+        //xm1 = xm1 - x ; x = 0
+        for(size_t i = 0 ; i < N ; ++i)
+            for(size_t k = 0 ; k < P ; ++k)
+                if(mask[k]){
+                    xm1[i*P+k] -= x[i*P+k];
+                    x[i*P+k] = 0;
+                }
+    }
+
+    template<class Fun>
+    void rebase(Fun &, ScalarType *, ScalarType *, size_t, size_t, mask_type const *, detail::int2type<false>){ }
+
+    template<class Fun>
+    void update_objective(Fun & fun, ScalarType const * x, size_t, mask_type const * mask, mask_type * updated, detail::int2type<true>){
+        fun(x, mask, updated, umintl::objective_update());
+    }
+
+    template<class Fun>
+    void update_objective(Fun &, ScalarType const *, size_t P, mask_type const *, mask_type * updated, detail::int2type<false>){
+        std::fill(updated, updated + P, 0);
+    }
+
+public:
+    /** @brief The constructor
+     *  @param _m number of curvature pairs kept by each problem
+     *  @param _iter maximum number of iterations
+     *  @param _tolerance threshold on the norm of the change of parameters (see parameter_change_threshold)
+     */
+    lockstep_minimizer(unsigned int _m = 7, size_t _iter = 1024, double _tolerance = 1e-5) : m(_m), iter(_iter), tolerance(_tolerance), max_evals(10), c1(1e-4), shrink(0.5), verbose(0){ }
+
+    unsigned int m;
+    size_t iter;
+    double tolerance;
+    unsigned int max_evals;
+    ScalarType c1;
+    ScalarType shrink;
+    unsigned int verbose;
+
+    /** @brief Minimizes the problems whose mask is non-zero
+     *
+     *  @param x the N*P interleaved initial guesses, overwritten by the results. The other problems are left untouched.
+     *  @param results the P optimization results, only written for the problems that are minimized
+     */
+    template<class Fun>
+    void operator()(ScalarType * x, Fun & fun, size_t N, size_t P, mask_type const * mask, optimization_result * results){
+        bool has_preconditioner = detail::is_call_possible<Fun,void(ScalarType const *, ScalarType const *, ScalarType *, mask_type const *, hessian_preconditioner)>::value;
+        detail::int2type<detail::is_call_possible<Fun,void(ScalarType const *, ScalarType const *, ScalarType *, mask_type const *, hessian_preconditioner)>::value> preconditioner_tag;
+        detail::int2type<detail::is_call_possible<Fun,void(ScalarType const *, mask_type const *, umintl::rebase)>::value> rebase_tag;
+        detail::int2type<detail::is_call_possible<Fun,void(ScalarType const *, mask_type const *, mask_type *, umintl::objective_update)>::value> update_tag;
+
+        std::vector<ScalarType> buffer(N*P*(6 + 2*m), 0);
+        ScalarType * xm1 = &buffer[0];
+        ScalarType * g = xm1 + N*P;
+        ScalarType * gm1 = g + N*P;
+        ScalarType * p = gm1 + N*P;
+        ScalarType * xt = p + N*P;
+        ScalarType * gt = xt + N*P;
+        ScalarType * s = gt + N*P;
+        ScalarType * y = s + m*N*P;
+
+        //Per-problem scalars
+        std::vector<ScalarType> scalars(P*(7 + 2*m), 0);
+        ScalarType * val = &scalars[0];
+        ScalarType * valt = val + P;
+        ScalarType * dphi_0 = valt + P;
+        ScalarType * alpha = dphi_0 + P;
+        ScalarType * coef = alpha + P;
+        ScalarType * tmp = coef + P;
+        ScalarType * scale = tmp + P;
+        ScalarType * rho = scale + P;
+        ScalarType * beta = rho + m*P;
+
+        std::vector<mask_type> active(P);
+        std::vector<mask_type> pending(P);
+        std::vector<mask_type> restart(P);
+        std::vector<mask_type> accepted(P);
+        std::vector<mask_type> updated(P, 0);
+        std::vector<mask_type> fresh(P, 0);
+        for(size_t k = 0 ; k < P ; ++k)
+            active[k] = mask[k]?1:0;
+        std::vector<size_t> nevals(P, 0);
+
+        //Pair j is stored in slot (head - 1 - j)%m
+        unsigned int head = 0;
+        unsigned int n_valid_pairs = 0;
+
+        fun((ScalarType const *)x, val, g, &active[0]);
+        for(size_t k = 0 ; k < P ; ++k)
+            nevals[k] += active[k];
+
+        size_t it = 0;
+        for( ; it < iter && std::find(active.begin(), active.end(), 1)!=active.end() ; ++it){
+            if(verbose >= 1){
+                std::cout << "Iteration " << std::setw(4) << it
+                          << ": active=" << std::setw(4) << std::count(active.begin(), active.end(), 1) << std::endl;
+            }
+
+            //p = -g, as steepest descent for the first iteration
+            for(size_t i = 0 ; i < N*P ; ++i)
+                p[i] = -g[i];
+
+            if(it > 0){
+                ScalarType * news = s + head*N*P;
+                ScalarType * newy = y + head*N*P;
+                ScalarType * newrho = rho + head*P;
+                head = (head+1)%m;
+                n_valid_pairs = std::min(n_valid_pairs+1, m);
+
+                sub(N, P, x, xm1, news);
+                sub(N, P, g, gm1, newy);
+                dot(N, P, newy, news, tmp);
+                dot(N, P, newy, newy, scale);
+                for(size_t k = 0 ; k < P ; ++k){
+                    newrho[k] = (active[k] && !fresh[k])?1/tmp[k]:0;
+                    scale[k] = active[k]?tmp[k]/scale[k]:0;
+                }
+
+                for(unsigned int j = 0 ; j < n_valid_pairs ; ++j){
+                    unsigned int slot = (head + m - 1 - j)%m;
+                    //beta_j = rho_j*s_j'p ; p = p - beta_j*y_j
+                    dot(N, P, s + slot*N*P, p, tmp);
+                    for(size_t k = 0 ; k < P ; ++k){
+                        beta[slot*P+k] = rho[slot*P+k]*tmp[k];
+                        coef[k] = -beta[slot*P+k];
+                    }
+                    axpy(N, P, coef, y + slot*N*P, p);
+                }
+
+                //p = H0*p
+                if(has_preconditioner){
+                    precondition(fun, x, p, xt, &active[0], preconditioner_tag);
+                    std::copy(xt, xt + N*P, p);
+                }
+                else{
+                    for(size_t i = 0 ; i < N ; ++i)
+                        for(size_t k = 0 ; k < P ; ++k)
+                            p[i*P+k] *= scale[k];
+                }
+
+                for(int j = (int)n_valid_pairs - 1 ; j >= 0 ; --j){
+                    unsigned int slot = (head + m - 1 - j)%m;
+                    //p = p + (beta_j - rho_j*y_j'p)*s_j
+                    dot(N, P, y + slot*N*P, p, tmp);
+                    for(size_t k = 0 ; k < P ; ++k)
+                        coef[k] = beta[slot*P+k] - rho[slot*P+k]*tmp[k];
+                    axpy(N, P, coef, s + slot*N*P, p);
+                }
+            }
+
+            //Steepest descent right after an update of the objective
+            if(std::find(fresh.begin(), fresh.end(), 1)!=fresh.end()){
+                for(size_t i = 0 ; i < N ; ++i)
+                    for(size_t k = 0 ; k < P ; ++k)
+                        p[i*P+k] = fresh[k]?-g[i*P+k]:p[i*P+k];
+            }
+
+            //Not a descent direction : steepest descent for this iteration
+            dot(N, P, p, g, dphi_0);
+            for(size_t k = 0 ; k < P ; ++k)
+                restart[k] = active[k] && dphi_0[k] >= 0;
+            if(std::find(restart.begin(), restart.end(), 1)!=restart.end()){
+                for(size_t i = 0 ; i < N ; ++i)
+                    for(size_t k = 0 ; k < P ; ++k)
+                        p[i*P+k] = restart[k]?-g[i*P+k]:p[i*P+k];
+                dot(N, P, p, g, dphi_0);
+            }
+
+            //Backtracking, over the problems whose step is not accepted yet
+            std::fill(alpha, alpha + P, (ScalarType)1);
+            pending = active;
+            for(unsigned int e = 0 ; e < max_evals && std::find(pending.begin(), pending.end(), 1)!=pending.end() ; ++e){
+                for(size_t i = 0 ; i < N ; ++i)
+                    for(size_t k = 0 ; k < P ; ++k)
+                        xt[i*P+k] = x[i*P+k] + alpha[k]*p[i*P+k];
+                fun((ScalarType const *)xt, valt, gt, &pending[0]);
+                for(size_t k = 0 ; k < P ; ++k){
+                    if(!pending[k])
+                        continue;
+                    nevals[k]++;
+                    if(valt[k] <= val[k] + c1*alpha[k]*dphi_0[k])
+                        pending[k] = 0;
+                    else
+                        alpha[k] *= shrink;
+                }
+            }
+
+            //The active problems still pending failed their line-search
+            for(size_t k = 0 ; k < P ; ++k){
+                accepted[k] = active[k] && !pending[k];
+                if(active[k] && pending[k]){
+                    active[k] = 0;
+                    results[k].termination_cause = optimization_result::LINE_SEARCH_FAILED;
+                    results[k].iteration = it;
+                }
+            }
+
+            //xm1 = x ; x = xt ; gm1 = g ; g = gt
+            select(N, P, &accepted[0], x, xm1);
+            select(N, P, &accepted[0], xt, x);
+            select(N, P, &accepted[0], g, gm1);
+            select(N, P, &accepted[0], gt, g);
+            for(size_t k = 0 ; k < P ; ++k)
+                val[k] = accepted[k]?valt[k]:val[k];
+
+            //Relative parametrizations : the new iterates become the origins
+            rebase(fun, x, xm1, N, P, &accepted[0], rebase_tag);
+
+            //Objectives that adapt to the iterates : the updated problems get their value and gradient recomputed, and
+            //forget their pairs, whose rho is zeroed. The pair of their next step, which straddles the two objectives,
+            //is ignored the same way
+            update_objective(fun, (ScalarType const *)x, P, &accepted[0], &updated[0], update_tag);
+            for(size_t k = 0 ; k < P ; ++k)
+                updated[k] = accepted[k] && updated[k];
+            if(std::find(updated.begin(), updated.end(), 1)!=updated.end()){
+                fun((ScalarType const *)x, val, g, &updated[0]);
+                for(size_t k = 0 ; k < P ; ++k){
+                    nevals[k] += updated[k];
+                    for(unsigned int j = 0 ; j < m && updated[k] ; ++j)
+                        rho[j*P+k] = 0;
+                }
+            }
+            fresh = updated;
+
+            //Parameter change threshold
+            sub(N, P, x, xm1, xt);
+            dot(N, P, xt, xt, tmp);
+            for(size_t k = 0 ; k < P ; ++k){
+                if(accepted[k] && !updated[k] && std::sqrt(tmp[k]) < tolerance){
+                    active[k] = 0;
+                    results[k].termination_cause = optimization_result::STOPPING_CRITERION;
+                    results[k].iteration = it;
+                }
+            }
+        }
+
+        for(size_t k = 0 ; k < P ; ++k){
+            if(!mask[k])
+                continue;
+            if(active[k]){
+                results[k].termination_cause = optimization_result::MAX_ITERATION_REACHED;
+                results[k].iteration = it;
+            }
+            results[k].f = val[k];
+            results[k].n_functions_eval = nevals[k];
+            results[k].n_gradient_eval = nevals[k];
+        }
+    }
+};
+
+}
+
+#endif
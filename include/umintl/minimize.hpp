@@ -14,6 +14,7 @@
 #include "umintl/model_base.hpp"
 
 #include "umintl/function_wrapper.hpp"
+#include "umintl/backends/fused.hpp"
 #include "umintl/optimization_context.hpp"
 
 #include "umintl/directions/conjugate_gradient.hpp"
@@ -23,6 +24,7 @@
 #include "umintl/directions/truncated_newton.hpp"
 
 #include "umintl/line_search/strong_wolfe_powell.hpp"
+#include "umintl/line_search/backtracking.hpp"
 
 #include "umintl/stopping_criterion/value_treshold.hpp"
 #include "umintl/stopping_criterion/gradient_treshold.hpp"
@@ -32,12 +34,7 @@
 
 namespace umintl{
 
-    /** @brief The minimizer class
-     *
-     *  @tparam BackendType the linear algebra backend of the minimizer
-     */
-    template<class BackendType>
-    class minimizer{
+    namespace detail{
 
         class IosFlagSaver {
         public:
@@ -59,57 +56,13 @@ namespace umintl{
             std::ios f;
         };
 
-    public:
-
-        /** @brief The constructor
-         *
-         * @param _direction the descent direction used by the minimizer
-         * @param _stopping_criterion the stopping criterion
-         * @param _iter the maximum number of iterations
-         * @param _verbose the verbose level
-         */
-        minimizer(umintl::direction<BackendType> * _direction = new quasi_newton<BackendType>()
-                             , umintl::stopping_criterion<BackendType> * _stopping_criterion = new gradient_treshold<BackendType>()
-                             , unsigned int _iter = 1024, unsigned int _verbose = 0) :
-            direction(_direction)
-          , line_search(new strong_wolfe_powell<BackendType>())
-          , stopping_criterion(_stopping_criterion)
-          , model(new deterministic<BackendType>())
-          , hessian_vector_product_computation(CENTERED_DIFFERENCE)
-          , verbose(_verbose), iter(_iter){
-
-        }
-
-        tools::shared_ptr<umintl::direction<BackendType> > direction;
-        tools::shared_ptr<umintl::line_search<BackendType> > line_search;
-        tools::shared_ptr<umintl::stopping_criterion<BackendType> > stopping_criterion;
-        tools::shared_ptr< model_base<BackendType> > model;
-        computation_type hessian_vector_product_computation;
-
-        double tolerance;
-
-        unsigned int verbose;
-        unsigned int iter;
-
-    private:
-
-        /** @brief Get a brief info string on the minimizer
-         *
-         *  @return String containing the verbose level, maximum number of iteration, and the direction used
-         */
-        std::string info() const{
-          std::ostringstream oss;
-          oss << "Verbosity Level : " << verbose << std::endl;
-          oss << "Maximum number of iterations : " << iter << std::endl;
-          oss << "Direction : " << direction->info() << std::endl;
-          return oss.str();
-        }
-
         /** @brief Clean memory and terminate the optimization result
          *
          *  @return Optimization result
          */
-        optimization_result terminate(optimization_result::termination_cause_type termination_cause, typename BackendType::VectorType & res, size_t N, optimization_context<BackendType> & context){
+        template<class BackendType, class DirectionType, class LineSearchType, class StopType>
+        optimization_result terminate(optimization_result::termination_cause_type termination_cause, typename BackendType::VectorType & res, size_t N, optimization_context<BackendType> & context
+                                      , DirectionType & direction, LineSearchType & line_search, StopType & stopping_criterion){
             optimization_result result;
             BackendType::copy(N,context.x(),res);
             result.f = context.val();
@@ -118,42 +71,32 @@ namespace umintl{
             result.n_gradient_eval = context.fun().n_gradient_computations();
             result.termination_cause = termination_cause;
 
-            clean_all(context);
+            direction.clean(context);
+            line_search.clean(context);
+            stopping_criterion.clean(context);
 
             return result;
         }
 
-        /** @brief Init the components of the procedure (ie allocate memory for the temporaries, typically)
-         */
-        void init_all(optimization_context<BackendType> & c){
-            direction->init(c);
-            line_search->init(c);
-            stopping_criterion->init(c);
-        }
-
-        /** @brief Clean the components of the procedure (ie free memory for the temporaries, typically)
+        /** @brief The main loop of the minimizers
+         *
+         *  The components are taken by reference to their static type : with the abstract bases, every call is
+         *  dispatched at runtime ; with the concrete classes, the calls are resolved at compile time and inlined.
          */
-        void clean_all(optimization_context<BackendType> & c){
-            direction->clean(c);
-            line_search->clean(c);
-            stopping_criterion->clean(c);
-        }
-
-    public:
-        template<class Fun>
-        optimization_result operator()(typename BackendType::VectorType & res, Fun & fun, typename BackendType::VectorType const & x0, size_t N){
-
-            tools::shared_ptr<umintl::direction<BackendType> > steepest_descent(new umintl::steepest_descent<BackendType>());
+        template<class BackendType, class DirectionType, class LineSearchType, class StopType, class ModelType, class Fun>
+        optimization_result minimize(typename BackendType::VectorType & res, Fun & fun, typename BackendType::VectorType const & x0, size_t N
+                                     , DirectionType & direction, LineSearchType & line_search, StopType & stopping_criterion, ModelType & model
+                                     , computation_type hessian_vector_product_computation, unsigned int iter, unsigned int verbose){
+            umintl::steepest_descent<BackendType> steepest_descent;
             line_search_result<BackendType> search_res(N);
-            optimization_context<BackendType> c(x0, N, *model, new detail::function_wrapper_impl<BackendType, Fun>(fun,N,hessian_vector_product_computation));
+            optimization_context<BackendType> c(x0, N, model, new detail::function_wrapper_impl<BackendType, Fun>(fun,N,hessian_vector_product_computation));
 
-            init_all(c);
+            direction.init(c);
+            line_search.init(c);
+            stopping_criterion.init(c);
 
-            tools::shared_ptr<umintl::direction<BackendType> > current_direction;
-            if(dynamic_cast<truncated_newton<BackendType> * >(direction.get()))
-              current_direction = direction;
-            else
-              current_direction = steepest_descent;
+            //The directions built from the previous steps start with a steepest descent step
+            bool use_steepest_descent = !direction.uses_hessian();
 
             //Main loop
             c.fun().compute_value_gradient(c.x(), c.val(), c.g(), c.model().get_value_gradient_tag());
@@ -164,50 +107,195 @@ namespace umintl{
                               << ": cost=" << std::fixed << std::setw(6) << std::setprecision(4) << c.val()
                               << "; NV=" << std::setw(4) << c.fun().n_value_computations()
                               << "; NG=" << std::setw(4) << c.fun().n_gradient_computations();
-                    if(dynamic_cast<truncated_newton<BackendType>*>(direction.get()))
+                    if(direction.uses_hessian())
                         std::cout<< "; NH=" << std::setw(4) << c.fun().n_hessian_vector_product_computations() ;
                     if(unsigned int ND = c.fun().n_datapoints_accessed())
                      std::cout << "; NPoints=" << std::scientific << std::setprecision(3) << (float)ND;
                     std::cout << std::endl;
                 }
 
-                (*current_direction)(c);
+                if(use_steepest_descent)
+                    steepest_descent(c);
+                else
+                    direction(c);
 
                 c.dphi_0() = BackendType::dot(N,c.p(),c.g());
                 //Not a descent direction...
                 if(c.dphi_0()>=0){
-                    //current_direction->reset(c);
-                    current_direction = steepest_descent;
-                    (*current_direction)(c);
+                    use_steepest_descent = true;
+                    steepest_descent(c);
                     c.dphi_0() = BackendType::dot(N,c.p(),c.g());
                 }
 
-                (*line_search)(search_res, current_direction.get(), c);
+                if(use_steepest_descent)
+                    line_search(search_res, &steepest_descent, c);
+                else
+                    line_search(search_res, &direction, c);
 
                 if(search_res.has_failed)
-                    return terminate(optimization_result::LINE_SEARCH_FAILED, res, N, c);
+                    return terminate(optimization_result::LINE_SEARCH_FAILED, res, N, c, direction, line_search, stopping_criterion);
 
                 c.alpha() = search_res.best_alpha;
 
-                BackendType::copy(N,c.x(),c.xm1());
-                BackendType::copy(N,search_res.best_x,c.x());
+                //xm1 = x ; x = best_x (the old xm1 buffer is recycled by the next line search)
+                backend::fused<BackendType>::swap(c.x(),c.xm1());
+                backend::fused<BackendType>::swap(c.x(),search_res.best_x);
 
-                BackendType::copy(N,c.g(),c.gm1());
-                BackendType::copy(N,search_res.best_g,c.g());
+                backend::fused<BackendType>::swap(c.g(),c.gm1());
+                backend::fused<BackendType>::swap(c.g(),search_res.best_g);
 
                 c.valm1() = c.val();
                 c.val() = search_res.best_phi;
 
-                if((*stopping_criterion)(c)){
-                    return terminate(optimization_result::STOPPING_CRITERION, res, N, c);
+                //Relative parametrizations : the new iterate becomes the origin
+                if(c.fun().has_rebase()){
+                    c.fun().rebase(c.x());
+                    backend::fused<BackendType>::waxpby(N,1,c.xm1(),-1,c.x(),c.xm1()); //xm1 = xm1 - x
+                    BackendType::scale(N,0,c.x()); //x = 0
+                }
+
+                //Objectives that adapt to the iterates (e.g., re-estimated parameters) : the value and gradient are
+                //recomputed, and the next step cannot rely on the curvature of the previous objective. The iterate,
+                //the model and the components keep the rest of their state
+                if(c.fun().has_objective_update() && c.fun().update_objective(c.x())){
+                    c.fun().compute_value_gradient(c.x(), c.val(), c.g(), c.model().get_value_gradient_tag());
+                    direction.reset(c);
+                    use_steepest_descent = !direction.uses_hessian();
+                    continue;
                 }
-                current_direction = direction;
 
-                if(model->update(c))
+                if(stopping_criterion(c)){
+                    return terminate(optimization_result::STOPPING_CRITERION, res, N, c, direction, line_search, stopping_criterion);
+                }
+                use_steepest_descent = false;
+
+                if(model.update(c))
                   c.fun().compute_value_gradient(c.x(), c.val(), c.g(), c.model().get_value_gradient_tag());
             }
 
-            return terminate(optimization_result::MAX_ITERATION_REACHED, res, N, c);
+            return terminate(optimization_result::MAX_ITERATION_REACHED, res, N, c, direction, line_search, stopping_criterion);
+        }
+
+    }
+
+    /** @brief The minimizer class
+     *
+     *  The components are policies held by value, so that the compiler sees their exact type and can inline them. This
+     *  is the front end for the small problems, where a virtual call per component and per iteration is not
+     *  negligible. Leaving the policies to their defaults gives the runtime-configurable minimizer below.
+     *
+     *  @tparam BackendType the linear algebra backend of the minimizer
+     *  @tparam DirectionType the descent direction, derived from umintl::direction
+     *  @tparam LineSearchType the line search, derived from umintl::line_search
+     *  @tparam StopType the stopping criterion, derived from umintl::stopping_criterion
+     *  @tparam ModelType the evaluation model, derived from umintl::model_base
+     */
+    template<class BackendType
+             , class DirectionType = umintl::direction<BackendType>
+             , class LineSearchType = umintl::line_search<BackendType>
+             , class StopType = umintl::stopping_criterion<BackendType>
+             , class ModelType = model_base<BackendType> >
+    class minimizer{
+    public:
+
+        /** @brief The constructor
+         *
+         * @param _direction the descent direction used by the minimizer
+         * @param _line_search the line search
+         * @param _stopping_criterion the stopping criterion
+         * @param _model the evaluation model
+         * @param _iter the maximum number of iterations
+         * @param _verbose the verbose level
+         */
+        minimizer(DirectionType const & _direction = DirectionType()
+                  , LineSearchType const & _line_search = LineSearchType()
+                  , StopType const & _stopping_criterion = StopType()
+                  , ModelType const & _model = ModelType()
+                  , unsigned int _iter = 1024, unsigned int _verbose = 0) :
+            direction(_direction)
+          , line_search(_line_search)
+          , stopping_criterion(_stopping_criterion)
+          , model(_model)
+          , hessian_vector_product_computation(CENTERED_DIFFERENCE)
+          , verbose(_verbose), iter(_iter){
+
+        }
+
+        DirectionType direction;
+        LineSearchType line_search;
+        StopType stopping_criterion;
+        ModelType model;
+        computation_type hessian_vector_product_computation;
+
+        unsigned int verbose;
+        unsigned int iter;
+
+        template<class Fun>
+        optimization_result operator()(typename BackendType::VectorType & res, Fun & fun, typename BackendType::VectorType const & x0, size_t N){
+            return detail::minimize<BackendType>(res, fun, x0, N, direction, line_search, stopping_criterion, model
+                                                 , hessian_vector_product_computation, iter, verbose);
+        }
+    };
+
+    /** @brief The runtime-configurable minimizer
+     *
+     *  The components can be swapped at runtime, and are called through their virtual interface.
+     *
+     *  @tparam BackendType the linear algebra backend of the minimizer
+     */
+    template<class BackendType>
+    class minimizer<BackendType, umintl::direction<BackendType>, umintl::line_search<BackendType>, umintl::stopping_criterion<BackendType>, model_base<BackendType> >{
+    public:
+
+        /** @brief The constructor
+         *
+         * @param _direction the descent direction used by the minimizer
+         * @param _stopping_criterion the stopping criterion
+         * @param _iter the maximum number of iterations
+         * @param _verbose the verbose level
+         */
+        minimizer(umintl::direction<BackendType> * _direction = new quasi_newton<BackendType>()
+                             , umintl::stopping_criterion<BackendType> * _stopping_criterion = new gradient_treshold<BackendType>()
+                             , unsigned int _iter = 1024, unsigned int _verbose = 0) :
+            direction(_direction)
+          , line_search(new strong_wolfe_powell<BackendType>())
+          , stopping_criterion(_stopping_criterion)
+          , model(new deterministic<BackendType>())
+          , hessian_vector_product_computation(CENTERED_DIFFERENCE)
+          , verbose(_verbose), iter(_iter){
+
+        }
+
+        tools::shared_ptr<umintl::direction<BackendType> > direction;
+        tools::shared_ptr<umintl::line_search<BackendType> > line_search;
+        tools::shared_ptr<umintl::stopping_criterion<BackendType> > stopping_criterion;
+        tools::shared_ptr< model_base<BackendType> > model;
+        computation_type hessian_vector_product_computation;
+
+        double tolerance;
+
+        unsigned int verbose;
+        unsigned int iter;
+
+    private:
+
+        /** @brief Get a brief info string on the minimizer
+         *
+         *  @return String containing the verbose level, maximum number of iteration, and the direction used
+         */
+        std::string info() const{
+          std::ostringstream oss;
+          oss << "Verbosity Level : " << verbose << std::endl;
+          oss << "Maximum number of iterations : " << iter << std::endl;
+          oss << "Direction : " << direction->info() << std::endl;
+          return oss.str();
+        }
+
+    public:
+        template<class Fun>
+        optimization_result operator()(typename BackendType::VectorType & res, Fun & fun, typename BackendType::VectorType const & x0, size_t N){
+            return detail::minimize<BackendType>(res, fun, x0, N, *direction, *line_search, *stopping_criterion, *model
+                                                 , hessian_vector_product_computation, iter, verbose);
         }
     };
 
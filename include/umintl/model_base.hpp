@@ -5,6 +5,9 @@
 #include "umintl/forwards.h"
 #include "umintl/optimization_context.hpp"
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <random>
 
 namespace umintl{
 
@@ -57,6 +60,15 @@ private:
  * void operator()(VectorType const & X, VectorType & variance, umintl::gradient_variance_tag tag)
  *
  * The parameter tag contains the information on the current offset and sample size
+ *
+ * If block_size is non-zero, the dataset is cut into blocks of block_size consecutive points visited in a random
+ * order, so that the samples are random without the data having to be shuffled beforehand. The offset and sample size
+ * in the tags then refer to the concatenation of the blocks, described by the block_schedule they point to. The
+ * points after the last full block form a short final block, so that a full batch uses all the points.
+ *
+ * If subset is non-zero, the dataset is restricted to its first subset points (whole blocks, in the random order, if
+ * block_size is non-zero, and the short block only if all the full ones are kept), e.g. for the coarse levels of a
+ * multilevel schedule. With fbatch >= subset, the samples then stay the same at each iteration.
  */
 template<class BackendType>
 struct dynamically_sampled : public model_base<BackendType> {
@@ -65,7 +77,26 @@ struct dynamically_sampled : public model_base<BackendType> {
     typedef typename BackendType::VectorType VectorType;
 
   public:
-    dynamically_sampled(double r, size_t fbatch, size_t dataset_size, double theta = 0.5) : theta_(theta), r_(r), S(std::min(fbatch,dataset_size)), offset_(0), H_offset_(0), N(dataset_size){ }
+    dynamically_sampled(double r, size_t fbatch, size_t dataset_size, double theta = 0.5, size_t block_size = 0, size_t subset = 0) : theta_(theta), r_(r), S(std::min(fbatch,dataset_size)), offset_(0), H_offset_(0), N(dataset_size), schedule_(0,std::vector<size_t>()){
+      if(block_size > 0 && block_size < dataset_size){
+        size_t nfull = dataset_size/block_size;
+        schedule_.block_size = block_size;
+        schedule_.dataset_size = dataset_size;
+        schedule_.order.resize(nfull);
+        for(size_t i = 0 ; i < nfull ; ++i)
+          schedule_.order[i] = i;
+        std::minstd_rand gen(0);
+        std::shuffle(schedule_.order.begin(), schedule_.order.end(), gen);
+        if(subset > 0)
+          schedule_.order.resize(std::min(nfull, std::max<size_t>(1, subset/block_size)));
+        if(schedule_.order.size()==nfull && dataset_size%block_size > 0)
+          schedule_.order.push_back(nfull);
+        N = schedule_.size();
+      }
+      else if(subset > 0)
+        N = std::min(N, subset);
+      S = std::min(S,N);
+    }
 
     bool update(optimization_context<BackendType> & c){
       if(S==N){
@@ -74,7 +105,7 @@ struct dynamically_sampled : public model_base<BackendType> {
       }
       else{
         VectorType var = BackendType::create_vector(c.N());
-        c.fun().compute_gradient_variance(c.x(),var,gradient_variance(STOCHASTIC,S,offset_));
+        c.fun().compute_gradient_variance(c.x(),var,gradient_variance(STOCHASTIC,S,offset_,blocks()));
 
         //is_descent_direction = norm1(var)/S*[(N-S)/(N-1)] <= theta^2*norm2(grad)^2
         ScalarType nrm1var = BackendType::asum(c.N(),var);
@@ -104,19 +135,22 @@ struct dynamically_sampled : public model_base<BackendType> {
     }
 
     value_gradient get_value_gradient_tag() const {
-      return value_gradient(STOCHASTIC,S,offset_);
+      return value_gradient(STOCHASTIC,S,offset_,blocks());
     }
 
     hessian_vector_product get_hv_product_tag() const {
-      return hessian_vector_product(STOCHASTIC,(size_t)(r_*S),H_offset_+offset_);
+      return hessian_vector_product(STOCHASTIC,(size_t)(r_*S),H_offset_+offset_,blocks());
     }
 private:
+    block_schedule const * blocks() const { return schedule_.block_size?&schedule_:NULL; }
+
     double theta_;
     double r_;
     size_t S;
     size_t offset_;
     size_t H_offset_;
     size_t N;
+    block_schedule schedule_;
 };
 
 
@@ -29,7 +29,7 @@ namespace umintl{
         typedef typename BackendType::VectorType VectorType;
         typedef typename BackendType::MatrixType MatrixType;
 
-        optimization_context(VectorType const & x0, size_t dim, model_base<BackendType> & model, detail::function_wrapper<BackendType> * fun) : fun_(fun), model_(model), iter_(0), dim_(dim){
+        optimization_context(VectorType const & x0, size_t dim, model_base<BackendType> & model, detail::function_wrapper<BackendType> * fun) : fun_(fun), model_(model), iter_(0), dim_(dim), alpha_(0){
             x_ = BackendType::create_vector(dim_);
             g_ = BackendType::create_vector(dim_);
             p_ = BackendType::create_vector(dim_);
@@ -37,6 +37,8 @@ namespace umintl{
             gm1_ = BackendType::create_vector(dim_);
 
             BackendType::copy(dim_,x0,x_);
+            //The truncated newton direction starts its CG from alpha*p, i.e. from 0 at the first iteration
+            BackendType::set_to_value(p_,0,dim_);
         }
 
         model_base<BackendType> & model(){ return model_; }
@@ -11,6 +11,7 @@
 #include <cmath>
 
 #include "umintl/optimization_context.hpp"
+#include "umintl/backends/fused.hpp"
 #include "forwards.h"
 
 namespace umintl{
@@ -24,11 +25,7 @@ struct parameter_change_threshold : public stopping_criterion<BackendType>{
     parameter_change_threshold(double _tolerance = 1e-5) : tolerance(_tolerance){ }
     double tolerance;
     bool operator()(optimization_context<BackendType> & c){
-        typename BackendType::VectorType tmp = BackendType::create_vector(c.N());
-        BackendType::copy(c.N(),c.x(),tmp);
-        BackendType::axpy(c.N(),-1,c.xm1(),tmp);
-        double change = BackendType::nrm2(c.N(),tmp);
-        BackendType::delete_if_dynamically_allocated(tmp);
+        double change = backend::fused<BackendType>::diff_nrm2(c.N(),c.x(),c.xm1());
         return  change < tolerance;
     }
 };
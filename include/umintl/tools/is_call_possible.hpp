@@ -56,6 +56,8 @@ private:
    };
 
    template <class T> static T null_object() {}
+   //Only used in unevaluated operands : unlike a member call through a null pointer, it does not trip -Wnonnull
+   static derived_type & derived_object();
 
    template <bool has, typename F>
    struct impl { static const bool value = false; };
@@ -64,7 +66,7 @@ private:
       static const bool value =
          sizeof(
             return_value_check<type, r>::deduce((
-                     ((derived_type*)0)->operator()(null_object<arg1>()),
+                     derived_object().operator()(null_object<arg1>()),
                      details::void_exp_result<type>()))
          ) == sizeof(yes);
    };
@@ -73,7 +75,7 @@ private:
       static const bool value =
          sizeof(
             return_value_check<type, r>::deduce((
-                     ((derived_type*)0)->operator()(null_object<arg1>(), null_object<arg2>()),
+                     derived_object().operator()(null_object<arg1>(), null_object<arg2>()),
                      details::void_exp_result<type>()))
          ) == sizeof(yes);
    };
@@ -83,7 +85,7 @@ private:
       static const bool value =
          sizeof(
             return_value_check<type, r>::deduce(
-                  (((derived_type*)0)->operator()(null_object<arg1>(), null_object<arg2>(), null_object<arg3>()),
+                  (derived_object().operator()(null_object<arg1>(), null_object<arg2>(), null_object<arg3>()),
                      details::void_exp_result<type>()))
          ) == sizeof(yes);
    };
@@ -93,7 +95,7 @@ private:
       static const bool value =
          sizeof(
             return_value_check<type, r>::deduce(
-                  (((derived_type*)0)->operator()(null_object<arg1>(), null_object<arg2>(), null_object<arg3>(), null_object<arg4>()),
+                  (derived_object().operator()(null_object<arg1>(), null_object<arg2>(), null_object<arg3>(), null_object<arg4>()),
                      details::void_exp_result<type>()))
          ) == sizeof(yes);
    };
@@ -103,7 +105,7 @@ private:
       static const bool value =
          sizeof(
             return_value_check<type, r>::deduce(
-                  (((derived_type*)0)->operator()(null_object<arg1>(), null_object<arg2>(), null_object<arg3>(), null_object<arg4>(), null_object<arg5>()),
+                  (derived_object().operator()(null_object<arg1>(), null_object<arg2>(), null_object<arg3>(), null_object<arg4>(), null_object<arg5>()),
                      details::void_exp_result<type>()))
          ) == sizeof(yes);
    };
@@ -77,6 +77,14 @@ T infomax<T>::dphi(T z, T)
     return 1 - y*y;
 }
 
+template<class T>
+T infomax<T>::phi_dphi(T z, T, T & dphi)
+{
+    T y = std::tanh(z);
+    dphi = 1 - y*y;
+    return y;
+}
+
 template<class T>
 __m128 infomax<T>::logp(__m128 const & z, __m128 const &)
 {   return  _mm_add_ps(log_1pe(_mm_mul_ps(_m2, z)), _mm_add_ps(_mlog2, z)); }
@@ -92,6 +100,14 @@ __m128 infomax<T>::dphi(__m128 const &  z, __m128 const &)
     return 1 - y*y;
 }
 
+template<class T>
+__m128 infomax<T>::phi_dphi(__m128 const &  z, __m128 const &, __m128 & dphi)
+{
+    __m128 y = tanh(z);
+    dphi = _mm_sub_ps(_1, _mm_mul_ps(y, y));
+    return y;
+}
+
 /*
  * ---------------------------
  * Extended Infomax ICA
@@ -113,6 +129,14 @@ T extended_infomax<T>::dphi(T z, T k)
     return (1 + k) - k*y*y;
 }
 
+template<class T>
+T extended_infomax<T>::phi_dphi(T z, T k, T & dphi)
+{
+    T y = tanh(z);
+    dphi = (1 + k) - k*y*y;
+    return z + k*y;
+}
+
 template<class T>
 __m128 extended_infomax<T>::logp(__m128 const & z, __m128 const &  k)
 {
@@ -137,6 +161,15 @@ __m128 extended_infomax<T>::dphi(__m128 const &  z, __m128 const &  k)
                       _mm_mul_ps(k, _mm_mul_ps(y, y)));
 }
 
+template<class T>
+__m128 extended_infomax<T>::phi_dphi(__m128 const &  z, __m128 const &  k, __m128 & dphi)
+{
+    __m128 y = tanh(z);
+    dphi = _mm_sub_ps(_mm_add_ps(_1, k),
+                      _mm_mul_ps(k, _mm_mul_ps(y, y)));
+    return _mm_add_ps(z, _mm_mul_ps(k, y));
+}
+
 
 /*
  * ---------------------------
@@ -161,6 +194,23 @@ void dist<T, F>::dphi_fb(int64_t off, int64_t NS, T * pz, T* pk, T* res) const {
     }
 }
 
+template<class T, template<class> class F>
+void dist<T, F>::phi_stats_fb(int64_t off, int64_t NS, T* pz, T* pk, T* res, T* dphi_mean, T* zsq_mean) const{
+    for(int64_t c = 0 ; c < NC_ ; ++c){
+        double sdphi = 0, szsq = 0;
+        T k = pk[c];
+        for(int64_t f = off ; f < off + NS ; ++f){
+          T z = pz[c*NF_+f];
+          T dphi;
+          res[c*NF_+f] = F<T>::phi_dphi(z, k, dphi);
+          sdphi += dphi;
+          szsq += z*z;
+        }
+        dphi_mean[c] = sdphi/NS;
+        zsq_mean[c] = szsq/NS;
+    }
+}
+
 template<class T, template<class> class F>
 void dist<T, F>::mu_fb(int64_t off, int64_t NS, T * pz, T* pk, T* res) const {
     for(int64_t c = 0 ; c < NC_ ; ++c){
@@ -209,6 +259,42 @@ void dist<T, F>::dphi_sse3(int64_t off, int64_t NS, T* pz, T* pk, T* res) const
     }
 }
 
+template<class T, template<class> class F>
+void dist<T, F>::phi_stats_sse3(int64_t off, int64_t NS, T* pz, T* pk, T* res, T* dphi_mean, T* zsq_mean) const {
+    #pragma omp parallel for
+    for(int64_t c = 0 ; c < NC_ ; ++c){
+        __m128d vsdphi = _mm_set1_pd((double)0);
+        __m128d vszsq = _mm_set1_pd((double)0);
+        T k = pk[c];
+        __m128 vk = _mm_set1_ps(k);
+        double sdphi = 0, szsq = 0;
+        int64_t f = off;
+        for(; f < round_to_previous_multiple(off+NS-3,4)  ; f+=4){
+            __m128 z = load_cast_f32<T>(&pz[c*NF_+f]);
+            __m128 dphi;
+            cast_f32_store<T>(&res[c*NF_+f],F<T>::phi_dphi(z, vk, dphi));
+            __m128 zsq = _mm_mul_ps(z, z);
+            vsdphi=_mm_add_pd(vsdphi,_mm_cvtps_pd(dphi));
+            vsdphi=_mm_add_pd(vsdphi,_mm_cvtps_pd(_mm_movehl_ps(dphi,dphi)));
+            vszsq=_mm_add_pd(vszsq,_mm_cvtps_pd(zsq));
+            vszsq=_mm_add_pd(vszsq,_mm_cvtps_pd(_mm_movehl_ps(zsq,zsq)));
+        }
+        vsdphi = _mm_hadd_pd(vsdphi, vsdphi);
+        vszsq = _mm_hadd_pd(vszsq, vszsq);
+        _mm_store_sd(&sdphi, vsdphi);
+        _mm_store_sd(&szsq, vszsq);
+        for(; f < off+NS ; ++f){
+          T z = pz[c*NF_+f];
+          T dphi;
+          res[c*NF_+f] = F<T>::phi_dphi(z, k, dphi);
+          sdphi += dphi;
+          szsq += z*z;
+        }
+        dphi_mean[c] = sdphi/NS;
+        zsq_mean[c] = szsq/NS;
+    }
+}
+
 
 template<class T, template<class> class F>
 void dist<T, F>::mu_sse3(int64_t off, int64_t NS, T* pz, T* pk, T* res) const {
@@ -262,6 +348,15 @@ void dist<T, F>::dphi(int64_t off, int64_t NS, T * z1, T* signs, T* dphi) const
         dphi_fb(off, NS, z1, signs, dphi);
 }
 
+template<class T, template<class> class F>
+void dist<T, F>::phi(int64_t off, int64_t NS, T * z1, T* signs, T* phi, T* dphi_mean, T* zsq_mean) const
+{
+    if(cpu.HW_SSE3)
+        phi_stats_sse3(off, NS, z1, signs, phi, dphi_mean, zsq_mean);
+    else
+        phi_stats_fb(off, NS, z1, signs, phi, dphi_mean, zsq_mean);
+}
+
 template class dist<float, infomax>;
 template class dist<double, infomax>;
 template class dist<float, extended_infomax>;
@@ -10,12 +10,19 @@
 #include "neo_ica/ica.h"
 #include "neo_ica/dist.h"
 #include "neo_ica/backend/backend.hpp"
+#include "neo_ica/backend/channel_kernels.hpp"
 #include "neo_ica/tools/mex.hpp"
 #include "neo_ica/tools/shuffle.hpp"
 #include "neo_ica/tools/whiten.hpp"
+#include "neo_ica/tools/mapped_file.hpp"
+#include "neo_ica/tools/scratch.hpp"
+#include "neo_ica/tools/compressed.hpp"
+#include "neo_ica/tools/statistics.hpp"
+#include "neo_ica/tools/hessian.hpp"
 
 #include "umintl/debug.hpp"
 #include "umintl/minimize.hpp"
+#include "umintl/lockstep.hpp"
 #include "umintl/stopping_criterion/parameter_change_threshold.hpp"
 #include "umintl/stopping_criterion/gradient_treshold.hpp"
 
@@ -23,6 +30,15 @@
 
 #include <stdlib.h>
 #include <memory>
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <numeric>
+#include <sstream>
 
 namespace neo_ica{
 
@@ -33,18 +49,262 @@ inline int omp_thread_count() {
     return n;
 }
 
+/* Sets signs[c] to 1 if the c-th channel of stats is super-gaussian, -1 otherwise. Returns true if any sign has
+ * changed */
+template<class T, class S>
+bool kurtosis_signs(tools::channel_statistics<T> const & stats, S * signs){
+    bool sign_change = false;
+    for(int64_t c = 0 ; c < stats.channels() ; ++c){
+        S new_sign = (S)((stats.kurtosis(c)+0.02>0)?1:-1);
+        sign_change |= (new_sign!=signs[c]);
+        signs[c] = new_sign;
+    }
+    return sign_change;
+}
+
+/* Contiguous ranges (first, size) of data points used by an operation.
+ * Without a block schedule, this is either the whole dataset or [offset, offset+sample_size). Otherwise, offset and
+ * sample_size refer to the concatenation of the scheduled blocks, and the blocks that happen to be adjacent in memory
+ * are merged. */
+typedef std::vector< std::pair<int64_t, int64_t> > segments_t;
+
+inline segments_t segments(umintl::operation_tag const & tag, int64_t NF){
+    segments_t res;
+    if(tag.model==umintl::DETERMINISTIC)
+        res.push_back(std::make_pair((int64_t)0, NF));
+    else if(tag.blocks==NULL)
+        res.push_back(std::make_pair((int64_t)tag.offset, (int64_t)tag.sample_size));
+    else{
+        int64_t bs = tag.blocks->block_size;
+        int64_t end = std::min<int64_t>(tag.offset + tag.sample_size, tag.blocks->size());
+        for(int64_t v = tag.offset ; v < end ; ){
+            int64_t len = std::min(end - v, bs - v%bs);
+            int64_t first = tag.blocks->order[v/bs]*bs + v%bs;
+            if(!res.empty() && res.back().first + res.back().second == first)
+                res.back().second += len;
+            else
+                res.push_back(std::make_pair(first, len));
+            v += len;
+        }
+    }
+    return res;
+}
+
+inline int64_t total_size(segments_t const & segs){
+    int64_t res = 0;
+    for(segments_t::const_iterator it = segs.begin() ; it != segs.end() ; ++it)
+        res += it->second;
+    return res;
+}
+
+/* Whitened data, NC channels of NF samples, either in memory (data[c*NF + f]), compressed in memory, or in a scratch file
+ *
+ * The objectives only access it through for_each(segs, fn), which calls fn(X, ld, len) on consecutive chunks of len
+ * samples covering the segments, with X[c*ld + f] the f-th sample of channel c in the chunk. In memory, the chunks are
+ * the segments themselves. Compressed, the segments are split into tiles small enough to stay in cache, each decoded
+ * right before fn consumes it. Out of core, the segments are split at the block boundaries of the file, and the next
+ * chunk is read in the background while fn processes the current one.
+ */
+template<class T>
+class whitened_data{
+    struct chunk{
+        int64_t block;
+        int64_t first;
+        int64_t len;
+    };
+
+    /* Splits the segments at the multiples of chunk_size() */
+    std::vector<chunk> split(segments_t const & segs) const{
+        int64_t B = chunk_size();
+        std::vector<chunk> res;
+        for(segments_t::const_iterator it = segs.begin() ; it != segs.end() ; ++it)
+            for(int64_t f = it->first ; f < it->first + it->second ; ){
+                chunk ck = {f/B, f%B, std::min(it->first + it->second - f, B - f%B)};
+                res.push_back(ck);
+                f += ck.len;
+            }
+        return res;
+    }
+
+public:
+    whitened_data(T const * data, int64_t NC, int64_t NF) : data_(data), codes_(NULL), file_(NULL), NC_(NC), NF_(NF), tile_(NF){ }
+    whitened_data(tools::compressed_data<T> const & codes, int64_t tile) : data_(NULL), codes_(&codes), file_(NULL), NC_(codes.channels()), NF_(codes.samples()), tile_(std::min(tile, codes.samples())){
+        buffers_[0].resize(NC_*tile_);
+    }
+    whitened_data(tools::scratch_file<T> const & file) : data_(NULL), codes_(NULL), file_(&file), NC_(file.channels()), NF_(file.samples()), tile_(file.block_size()){
+        buffers_[0].resize(NC_*tile_);
+        buffers_[1].resize(NC_*tile_);
+    }
+
+    int64_t channels() const { return NC_; }
+    int64_t samples() const { return NF_; }
+
+    /* Upper bound on the size of the chunks */
+    int64_t chunk_size() const { return tile_; }
+
+    template<class F>
+    void for_each(segments_t const & segs, F fn) const{
+        if(data_){
+            for(segments_t::const_iterator it = segs.begin() ; it != segs.end() ; ++it)
+                fn(data_ + it->first, NF_, it->second);
+            return;
+        }
+
+        int64_t B = tile_;
+        std::vector<chunk> chunks = split(segs);
+        if(codes_){
+            T * X = buffers_[0].data();
+            for(size_t k = 0 ; k < chunks.size() ; ++k){
+                codes_->decode(chunks[k].block*B + chunks[k].first, chunks[k].len, X, B);
+                fn((T const *)X, B, chunks[k].len);
+            }
+            return;
+        }
+
+        //A single reader thread for the whole pass fills the two buffers in turn, one chunk ahead of fn
+        tools::scratch_file<T> const * file = file_;
+        std::mutex mutex;
+        std::condition_variable cond;
+        size_t nread = 0, nconsumed = 0;
+        bool stopped = false;
+        std::exception_ptr error;
+        std::thread reader([&](){
+            for(size_t k = 0 ; k < chunks.size() ; ++k){
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond.wait(lock, [&](){ return stopped || k < nconsumed + 2; });
+                    if(stopped)
+                        return;
+                }
+                std::exception_ptr failure;
+                try{
+                    file->read(chunks[k].block, chunks[k].first, chunks[k].len, buffers_[k%2].data(), B);
+                }
+                catch(...){
+                    failure = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if(failure){
+                    error = failure;
+                    cond.notify_all();
+                    return;
+                }
+                nread = k + 1;
+                cond.notify_all();
+            }
+        });
+
+        try{
+            for(size_t k = 0 ; k < chunks.size() ; ++k){
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond.wait(lock, [&](){ return error || k < nread; });
+                    if(error)
+                        break;
+                }
+                fn((T const *)buffers_[k%2].data(), B, chunks[k].len);
+                std::lock_guard<std::mutex> lock(mutex);
+                nconsumed = k + 1;
+                cond.notify_all();
+            }
+        }
+        catch(...){
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopped = true;
+                cond.notify_all();
+            }
+            reader.join();
+            throw;
+        }
+        reader.join();
+        if(error)
+            std::rethrow_exception(error);
+    }
+
+private:
+    T const * data_;
+    tools::compressed_data<T> const * codes_;
+    tools::scratch_file<T> const * file_;
+    int64_t NC_;
+    int64_t NF_;
+    int64_t tile_;
+    mutable std::vector<T> buffers_[2];
+};
+
+/* Kurtosis signs of X*W (of X if W is NULL) over the whole data. Z is a chunk_size*NC buffer */
+template<class T>
+bool kurtosis_signs(whitened_data<T> const & data, T const * W, T * Z, T * signs){
+    int64_t NC = data.channels();
+    int64_t ldz = data.chunk_size();
+    tools::channel_statistics<T> stats(NC);
+    channel_kernels<T> kernels(NC);
+    data.for_each(segments_t(1, std::make_pair((int64_t)0, data.samples())), [&](T const * X, int64_t ld, int64_t len){
+        if(W==NULL)
+            stats.accumulate(len, X, ld);
+        else{
+            kernels.project(len,X,ld,W,Z,ldz);
+            stats.accumulate(len, (T const *)Z, ldz);
+        }
+    });
+    return kurtosis_signs(stats, signs);
+}
+
+/* res += weight*x */
+template<class T, class S>
+void accumulate(int64_t N, T weight, S const * x, T * res){
+    for(int64_t i = 0 ; i < N ; ++i)
+        res[i] += weight*x[i];
+}
+
+/* out = in, converted */
+template<class T, class S>
+void convert(int64_t N, T const * in, S * out){
+    for(int64_t i = 0 ; i < N ; ++i)
+        out[i] = (S)in[i];
+}
+
+/* R = alpha*X'*Y + beta*R, with X and Y two chunks of len samples of NC channels stored in S
+ *
+ * In mixed precision, the product of each chunk is formed in S and accumulated into R in T */
+template<class T, class S>
+struct chunk_product{
+    chunk_product(int64_t NC) : NC_(NC), kernels_(NC), buf_(NC*NC){ }
+
+    void operator()(int64_t len, T alpha, S const * X, int64_t ldx, S const * Y, int64_t ldy, T beta, T * R) const{
+        kernels_.cross(len,(S)alpha,X,ldx,Y,ldy,0,buf_.data());
+        for(int64_t i = 0 ; i < NC_*NC_ ; ++i)
+            R[i] = (beta==0)?buf_[i]:beta*R[i] + buf_[i];
+    }
+
+private:
+    int64_t NC_;
+    channel_kernels<S> kernels_;
+    mutable std::vector<S> buf_;
+};
+
 template<class T>
+struct chunk_product<T, T>{
+    chunk_product(int64_t NC) : kernels_(NC){ }
+
+    void operator()(int64_t len, T alpha, T const * X, int64_t ldx, T const * Y, int64_t ldy, T beta, T * R) const{
+        kernels_.cross(len,alpha,X,ldx,Y,ldy,beta,R);
+    }
+
+private:
+    channel_kernels<T> kernels_;
+};
+
+/* T : precision of the optimization, S : precision of the data and of the NC*NF intermediates */
+template<class T, class S = T>
 struct log_likelihood{
     typedef T * VectorType;
 
 public:
-    log_likelihood(T const * data, int64_t NF, int64_t NC, dist_base<T>* fn) : data_(data), NC_(NC), NF_(NF), fn_(fn){
-        ipiv_ =  new typename backend<T>::size_t[NC_+1];
-
-        //NC*NF matrices
-        Z = new T[NC_*NF_];
-        RZ = new T[NC_*NF_];
-        datasq_ = new T[NC_*NF_];
+    log_likelihood(whitened_data<S> const & data, dist_base<S>* fn) : data_(data), sign_interval_(0), sign_iterations_(0), z_stats_(data.channels()), NC_(data.channels()), LD_(data.chunk_size()), product_(NC_), kernels_(NC_), chunk_kernels_(NC_), fn_(fn){
+        //NC*chunk_size matrices
+        Z = new S[NC_*LD_];
+        RZ = new S[NC_*LD_];
 
         //NC*NC matrices
         psixT = new T[NC_*NC_];
@@ -56,57 +316,39 @@ public:
         HV = new T[NC_*NC_];
         WinvV = new T[NC_*NC_];
         mu = new T[NC_];
-        first_signs = new T[NC_];
-
-        for(int64_t i = 0 ; i < NC_; ++i)
-            for(int64_t j = 0; j < NF_; ++j)
-                datasq_[i*NF_+j] = data_[i*NF_+j]*data_[i*NF_+j];
+        dphi_mean_ = new T[NC_];
+        zsq_mean_ = new T[NC_];
+        chunk_means_ = new S[3*NC_];
+        Ws = new S[NC_*NC_];
+        first_signs = new S[NC_];
+        initial_signs_ = new S[NC_];
+        Vs = new S[NC_*NC_];
+
+        std::fill(first_signs, first_signs + NC_, (S)0);
+        kurtosis_signs(data_, (S const *)NULL, Z, first_signs);
+        std::copy(first_signs, first_signs + NC_, initial_signs_);
+    }
 
+    /* Restores the signs estimated on the whitened data, for a new optimization */
+    void reset(){
+        std::copy(initial_signs_, initial_signs_ + NC_, first_signs);
+        sign_iterations_ = 0;
+    }
 
-        for(int64_t c = 0 ; c < NC_ ; ++c){
-            T m2 = 0, m4 = 0;
-            for(int64_t f = 0; f < NF_ ; f++){
-                T X = data_[c*NF_+f];
-                m2 += std::pow(X,2);
-                m4 += std::pow(X,4);
-            }
-            m2 = std::pow(m2/NF_,2);
-            m4 = m4/NF_;
-            T k = m4/m2 - 3;
-            first_signs[c] = (T)((k+0.02>0)?1:-1);
-        }
+    /* Re-estimates the signs every interval iterations during the optimization (never if 0) */
+    void sign_interval(int64_t interval){
+        sign_interval_ = interval;
     }
 
     bool resigns(T* x){
-        bool sign_change = false;
-        std::memcpy(W, x,sizeof(T)*NC_*NC_);
-        backend<T>::gemm(NoTrans,NoTrans,NF_,NC_,NC_,1,data_,NF_,W,NC_,0,Z,NF_);
-
-        for(int64_t c = 0 ; c < NC_ ; ++c){
-            T m2 = 0, m4 = 0;
-            //ScalarType b = b_[c];
-            for(int64_t f = 0; f < NF_ ; f++){
-                T X = Z[c*NF_+f];
-                m2 += std::pow(X,2);
-                m4 += std::pow(X,4);
-            }
-
-            m2 = std::pow(1/(T)NF_*m2,2);
-            m4 = 1/(T)NF_*m4;
-            T k = m4/m2 - 3;
-            int new_sign = (k+0.02>0)?1:-1;
-            sign_change |= (new_sign!=first_signs[c]);
-            first_signs[c] = new_sign;
-        }
-        return sign_change;
+        convert(NC_*NC_, x, Ws);
+        return kurtosis_signs(data_, (S const *)Ws, Z, first_signs);
     }
 
     ~log_likelihood(){
-        delete[] ipiv_;
-        //NC*NF matrices
+        //NC*chunk_size matrices
         delete[] Z;
         delete[] RZ;
-        delete[] datasq_;
         //NC*NC matrices
         delete[] psixT;
         delete[] phixT;
@@ -117,45 +359,64 @@ public:
         delete[] WLU;
         delete[] WinvV;
         delete[] mu;
+        delete[] dphi_mean_;
+        delete[] zsq_mean_;
+        delete[] chunk_means_;
+        delete[] Ws;
+        delete[] first_signs;
+        delete[] initial_signs_;
+        delete[] Vs;
     }
 
-    /* Hessian-Vector product variance */
-    void operator()(VectorType const & x, VectorType const & v, VectorType & variance, umintl::hv_product_variance tag) const{
-        int64_t offset;
-        int64_t sample_size;
-        if(tag.model==umintl::DETERMINISTIC){
-          offset = 0;
-          sample_size = NF_;
-        }
-        else{
-          offset = tag.offset;
-          sample_size = tag.sample_size;
-        }
+    /* Preconditioner : z = W*inv(H)*W'*r, where H is the block-diagonal approximation of the Hessian
+     * in relative coordinates, built from the moments recorded by the last value_gradient pass */
+    void operator()(VectorType const & x, VectorType const & r, VectorType & z, umintl::hessian_preconditioner) const{
+        T* R = V;
+        T* D = HV;
 
-        //Z = X*W
+        //R = W'*r
         std::memcpy(W, x,sizeof(T)*NC_*NC_);
-        backend<T>::gemm(NoTrans,NoTrans,sample_size,NC_,NC_,1,data_+offset,NF_,W,NC_,0,Z+offset,NF_);
+        kernels_.gemm(Trans,NoTrans,1,W,r,0,R);
 
-        //RZ = X*V
-        std::memcpy(V, v,sizeof(T)*NC_*NC_);
-        backend<T>::gemm(NoTrans,NoTrans,sample_size,NC_,NC_,1,data_+offset,NF_,V,NC_,0,RZ+offset,NF_);
+        solve_hessian_blocks(NC_, dphi_mean_, zsq_mean_, R, D);
 
-        //Psi = dphi(Z).*RZ
-        //Reuse Z's buffer because not needed anymore after and elementwise
-        T* psi = Z;
-        T* dphi = Z;
-        fn_->dphi(offset,sample_size,Z,first_signs,dphi);
-        for(int64_t c = 0 ; c < NC_ ; ++c)
-            for(int64_t f = offset; f < offset+sample_size ; ++f)
-                psi[c*NF_+f] = dphi[c*NF_+f]*RZ[c*NF_+f];
-        backend<T>::gemm(Trans,NoTrans,NC_,NC_,sample_size ,1,data_+offset,NF_,psi+offset,NF_,0,psixT,NC_);
+        //z = W*D
+        kernels_.gemm(NoTrans,NoTrans,1,W,D,0,z);
+    }
 
+    /* Hessian-Vector product variance */
+    void operator()(VectorType const & x, VectorType const & v, VectorType & variance, umintl::hv_product_variance tag) const{
+        segments_t segs = segments(tag, data_.samples());
+        int64_t sample_size = total_size(segs);
+
+        std::memcpy(V, v,sizeof(T)*NC_*NC_);
+        convert(NC_*NC_, x, Ws);
+        convert(NC_*NC_, v, Vs);
+
+        T beta = 0;
+        data_.for_each(segs, [&](S const * X, int64_t ld, int64_t len){
+            //Psi = dphi(X*W).*(X*V)
+            //Reuses Z's buffer because the operation is elementwise
+            S* psi = Z;
+            chunk_kernels_.project(len,X,ld,Ws,Z,LD_);
+            chunk_kernels_.project(len,X,ld,Vs,RZ,LD_);
+            fn_->dphi(0,len,Z,first_signs,psi);
+            for(int64_t c = 0 ; c < NC_ ; ++c)
+                for(int64_t f = 0; f < len ; ++f)
+                    psi[c*LD_+f] *= RZ[c*LD_+f];
+            product_(len,1,X,ld,psi,LD_,beta,psixT);
+
+            //psi.^2*(x.^2)'
+            for(int64_t c = 0 ; c < NC_; ++c)
+                for(int64_t f = 0 ; f < len; ++f){
+                    psi[c*LD_+f] = psi[c*LD_+f]*psi[c*LD_+f];
+                    RZ[c*LD_+f] = X[c*ld+f]*X[c*ld+f];
+                }
+            product_(len,1,RZ,LD_,psi,LD_,beta,variance);
+            beta = 1;
+        });
 
         //Variance = 1/(N-1)[psi.^2*(x.^2)' - 1/N*psi*x']
-        for(int64_t i = 0 ; i < NC_; ++i)
-            for(int64_t j = offset ; j < offset+sample_size; ++j)
-                psi[i*NF_+j] = psi[i*NF_+j]*psi[i*NF_+j];
-        backend<T>::gemm(Trans,NoTrans,NC_,NC_,sample_size,1,datasq_+offset,NF_,psi+offset,NF_,0,variance,NC_);
         for(int64_t i = 0 ; i < NC_; ++i)
             for(int64_t j = 0 ; j < NC_; ++j)
               variance[i*NC_+j] = (T)1/(sample_size-1)*(variance[i*NC_+j] - psixT[i*NC_+j]*psixT[i*NC_+j]/(T)sample_size);
@@ -163,42 +424,33 @@ public:
 
     /* Hessian-Vector product */
     void operator()(VectorType const & x, VectorType const & v, VectorType & Hv, umintl::hessian_vector_product tag) const{
-        int64_t offset;
-        int64_t sample_size;
-        if(tag.model==umintl::DETERMINISTIC){
-          offset = 0;
-          sample_size = NF_;
-        }
-        else{
-          offset = tag.offset;
-          sample_size = tag.sample_size;
-        }
-
-        std::memcpy(W, x,sizeof(T)*NC_*NC_);
+        segments_t segs = segments(tag, data_.samples());
+        int64_t sample_size = total_size(segs);
 
-        //Z = X*W
-        backend<T>::gemm(NoTrans,NoTrans,sample_size,NC_,NC_,1,data_+offset,NF_,W,NC_,0,Z+offset,NF_);
-
-        //RZ = X*V
         std::memcpy(V, v,sizeof(T)*NC_*NC_);
-        backend<T>::gemm(NoTrans,NoTrans,sample_size,NC_,NC_,1,data_+offset,NF_,V,NC_,0,RZ+offset,NF_);
-
-        //Psi = dphi(Z).*RZ
-        //Reuse Z's buffer because not needed anymore after and elementwise
-        T* psi = Z;
-        T* dphi = Z;
-        fn_->dphi(offset,sample_size,Z,first_signs,dphi);
-        for(int64_t c = 0 ; c < NC_ ; ++c)
-            for(int64_t f = offset; f < offset+sample_size ; ++f)
-                psi[c*NF_+f] = dphi[c*NF_+f]*RZ[c*NF_+f];
+        convert(NC_*NC_, x, Ws);
+        convert(NC_*NC_, v, Vs);
+
+        T beta = 0;
+        data_.for_each(segs, [&](S const * X, int64_t ld, int64_t len){
+            //Psi = dphi(X*W).*(X*V)
+            //Reuses Z's buffer because the operation is elementwise
+            S* psi = Z;
+            chunk_kernels_.project(len,X,ld,Ws,Z,LD_);
+            chunk_kernels_.project(len,X,ld,Vs,RZ,LD_);
+            fn_->dphi(0,len,Z,first_signs,psi);
+            for(int64_t c = 0 ; c < NC_ ; ++c)
+                for(int64_t f = 0; f < len ; ++f)
+                    psi[c*LD_+f] *= RZ[c*LD_+f];
+            product_(len,1,X,ld,psi,LD_,beta,psixT);
+            beta = 1;
+        });
 
         //HV = (inv(W)*V*inv(w))' + 1/n*Psi*X'
         std::memcpy(WLU,x,sizeof(T)*NC_*NC_);
-        backend<T>::getrf(NC_,NC_,WLU,NC_,ipiv_);
-        backend<T>::getri(NC_,WLU,NC_,ipiv_);
-        backend<T>::gemm(Trans,Trans,NC_,NC_,NC_ ,1,WLU,NC_,V,NC_,0,WinvV,NC_);
-        backend<T>::gemm(NoTrans,Trans,NC_,NC_,NC_ ,1,WinvV,NC_,WLU,NC_,0,HV,NC_);
-        backend<T>::gemm(Trans,NoTrans,NC_,NC_,sample_size ,1,data_+offset,NF_,psi+offset,NF_,0,psixT,NC_);
+        kernels_.inverse(WLU);
+        kernels_.gemm(Trans,Trans,1,WLU,V,0,WinvV);
+        kernels_.gemm(NoTrans,Trans,1,WinvV,WLU,0,HV);
 
         //Copy back
         for(int64_t i = 0 ; i < NC_*NC_; ++i)
@@ -207,30 +459,29 @@ public:
 
     /* Gradient variance */
     void operator()(VectorType const & x, VectorType & variance, umintl::gradient_variance tag){
-        int64_t offset;
-        int64_t sample_size;
-        if(tag.model==umintl::DETERMINISTIC){
-          offset = 0;
-          sample_size = NF_;
-        }
-        else{
-          offset = tag.offset;
-          sample_size = tag.sample_size;
-        }
-
-        std::memcpy(W, x,sizeof(T)*NC_*NC_);
-
-        backend<T>::gemm(NoTrans,NoTrans,sample_size,NC_,NC_,1,data_+offset,NF_,W,NC_,0,Z+offset,NF_);
-
-        T* phi = Z;
-        fn_->phi(offset,sample_size,Z,first_signs,phi);
-        backend<T>::gemm(Trans,NoTrans,NC_,NC_,sample_size ,1,data_+offset,NF_,phi+offset,NF_,0,phixT,NC_);
+        segments_t segs = segments(tag, data_.samples());
+        int64_t sample_size = total_size(segs);
+
+        convert(NC_*NC_, x, Ws);
+
+        T beta = 0;
+        data_.for_each(segs, [&](S const * X, int64_t ld, int64_t len){
+            S* phi = Z;
+            chunk_kernels_.project(len,X,ld,Ws,Z,LD_);
+            fn_->phi(0,len,Z,first_signs,phi);
+            product_(len,1,X,ld,phi,LD_,beta,phixT);
+
+            //phi.^2*(x.^2)'
+            for(int64_t c = 0 ; c < NC_; ++c)
+                for(int64_t f = 0 ; f < len; ++f){
+                    phi[c*LD_+f] = phi[c*LD_+f]*phi[c*LD_+f];
+                    RZ[c*LD_+f] = X[c*ld+f]*X[c*ld+f];
+                }
+            product_(len,1,RZ,LD_,phi,LD_,beta,variance);
+            beta = 1;
+        });
 
         //GradVariance = 1/(N-1)[phi.^2*(x.^2)' - 1/N*phi*x']
-        for(int64_t i = 0 ; i < NC_; ++i)
-            for(int64_t j = offset ; j < offset+sample_size; ++j)
-                phi[i*NF_+j] = phi[i*NF_+j]*phi[i*NF_+j];
-        backend<T>::gemm(Trans,NoTrans,NC_,NC_,sample_size,1,datasq_+offset,NF_,phi+offset,NF_,0,variance,NC_);
         for(int64_t i = 0 ; i < NC_; ++i)
             for(int64_t j = 0 ; j < NC_; ++j)
               variance[i*NC_+j] = (T)1/(sample_size-1)*(variance[i*NC_+j] - phixT[i*NC_+j]*phixT[i*NC_+j]/(T)sample_size);
@@ -240,43 +491,45 @@ public:
     void operator()(VectorType const & x, T& value, VectorType & grad, umintl::value_gradient tag) const {
         throw_if_mex_and_ctrl_c();
 
-        int64_t offset;
-        int64_t sample_size;
-        if(tag.model==umintl::DETERMINISTIC){
-          offset = 0;
-          sample_size = NF_;
-        }
-        else{
-          offset = tag.offset;
-          sample_size = tag.sample_size;
-        }
+        segments_t segs = segments(tag, data_.samples());
+        int64_t sample_size = total_size(segs);
 
         //Rerolls the variables into the appropriates datastructures
         std::memcpy(W, x,sizeof(T)*NC_*NC_);
-
-        //Z = X*W;
-        backend<T>::gemm(NoTrans,NoTrans,sample_size,NC_,NC_,1,data_+offset,NF_,W,NC_,0,Z+offset,NF_);
-
-        //mu = mean(mata.*abs(Z).^(mata-1).*sign(Z),2);
-        fn_->mu(offset,sample_size,Z,first_signs,mu);
-
-        //LU Decomposition
+        convert(NC_*NC_, x, Ws);
+
+        //mu = mean(log p(Z)), phixT = Phi*X'
+        //Also records the moments used by the preconditioner
+        std::fill(mu, mu + NC_, (T)0);
+        std::fill(dphi_mean_, dphi_mean_ + NC_, (T)0);
+        std::fill(zsq_mean_, zsq_mean_ + NC_, (T)0);
+        z_stats_.clear();
+        T beta = 0;
+        data_.for_each(segs, [&](S const * X, int64_t ld, int64_t len){
+            T weight = (T)len/sample_size;
+            S* phi = Z;
+            chunk_kernels_.project(len,X,ld,Ws,Z,LD_);
+            if(sign_interval_ > 0)
+                z_stats_.accumulate(len,(S const *)Z,LD_);
+            fn_->mu(0,len,Z,first_signs,chunk_means_);
+            fn_->phi(0,len,Z,first_signs,phi,chunk_means_+NC_,chunk_means_+2*NC_);
+            accumulate(NC_,weight,chunk_means_,mu);
+            accumulate(NC_,weight,chunk_means_+NC_,dphi_mean_);
+            accumulate(NC_,weight,chunk_means_+2*NC_,zsq_mean_);
+            product_(len,1,X,ld,phi,LD_,beta,phixT);
+            beta = 1;
+        });
+
+        //WLU = inv(W)
         std::memcpy(WLU,W,sizeof(T)*NC_*NC_);
-        backend<T>::getrf(NC_,NC_,WLU,NC_,ipiv_);
+        T logabsdet = kernels_.inverse(WLU);
 
         //H = log(abs(det(w))) + sum(mu);
-        T logabsdet = 0;
-        for(int64_t i = 0 ; i < NC_ ; ++i)
-            logabsdet += std::log(std::abs(WLU[i*NC_+i]));
         T H = logabsdet;
         for(int64_t i = 0; i < NC_ ; ++i)
             H+=mu[i];
 
         //dweights = W^-T - 1/n*Phi*X'
-        T* phi = Z;
-        fn_->phi(offset,sample_size,Z,first_signs,phi);
-        backend<T>::gemm(Trans,NoTrans,NC_,NC_,sample_size ,1,data_+offset,NF_,phi+offset,NF_,0,phixT,NC_);
-        backend<T>::getri(NC_,WLU,NC_,ipiv_);
         for(int64_t i = 0 ; i < NC_; ++i)
             for(int64_t j = 0 ; j < NC_; ++j)
                 wmT[i*NC_+j] = WLU[j*NC_+i];
@@ -287,25 +540,36 @@ public:
           grad[i] = - (wmT[i] - phixT[i]/sample_size);
     }
 
+    /* Every sign_interval iterations, re-estimates the signs from the statistics of Z recorded by the last
+     * value_gradient pass, i.e. on the current sample at the accepted point. Returns true if any sign has changed */
+    bool operator()(VectorType const &, umintl::objective_update){
+        if(sign_interval_==0 || ++sign_iterations_ < sign_interval_)
+            return false;
+        sign_iterations_ = 0;
+        return kurtosis_signs(z_stats_, first_signs);
+    }
+
 private:
-    T const * data_;
-    T * first_signs;
+    whitened_data<S> const & data_;
+    S * first_signs;
+    S * initial_signs_;
+    int64_t sign_interval_;
+    int64_t sign_iterations_;
+    mutable tools::channel_statistics<S> z_stats_;
 
     int64_t NC_;
-    int64_t NF_;
-
+    int64_t LD_;
+    chunk_product<T, S> product_;
+    channel_kernels<T> kernels_;
+    channel_kernels<S> chunk_kernels_;
 
-    typename backend<T>::size_t *ipiv_;
 
-
-    T* Z ;
-    T* RZ;
+    S* Z ;
+    S* RZ;
 
     T* phixT;
     T* psixT;
 
-    T* datasq_;
-
     T* wmT;
     T* V;
     T* HV;
@@ -313,8 +577,320 @@ private:
     T* W;
     T* WLU;
     T* mu;
+    T* dphi_mean_;
+    T* zsq_mean_;
+    S* chunk_means_;
+    S* Ws;
+    S* Vs;
 
-    std::shared_ptr<dist_base<T>> fn_;
+    std::shared_ptr<dist_base<S>> fn_;
+};
+
+/* Log-likelihood in relative coordinates
+ *
+ * The optimization variable E parametrizes the weights as W = W0*(I+E), where W0 is the current origin.
+ * Once a step is accepted, the minimizer rebases the objective so that E = 0 again. The gradient returned is the
+ * relative gradient E[Z'phi(Z)] - I at W, which needs no inverse and is exact at the origin. The line-search
+ * must therefore only rely on the values at the trial points.
+ *
+ * In orthogonal mode, W0 stays orthogonal and W = W0*cayley(D), with D the skew-symmetric part of E. Since the data
+ * is white, the log-determinant vanishes and the gradient is the skew-symmetric part of E[Z'phi(Z)].
+ */
+template<class T, class S = T>
+struct relative_log_likelihood{
+    typedef T * VectorType;
+
+public:
+    relative_log_likelihood(whitened_data<S> const & data, dist_base<S>* fn, bool orthogonal = false) : data_(data), NC_(data.channels()), LD_(data.chunk_size()), product_(NC_), kernels_(NC_), chunk_kernels_(NC_), orthogonal_(orthogonal), sign_interval_(0), sign_iterations_(0), z_stats_(NC_), fn_(fn){
+        //NC*chunk_size matrix
+        Z = new S[NC_*LD_];
+
+        //NC*NC matrices
+        W0 = new T[NC_*NC_];
+        W = new T[NC_*NC_];
+        ELU = new T[NC_*NC_];
+        CAY = new T[NC_*NC_];
+        phixT = new T[NC_*NC_];
+        mu = new T[NC_];
+        dphi_mean_ = new T[NC_];
+        zsq_mean_ = new T[NC_];
+        zphi_mean_ = new T[NC_];
+        chunk_means_ = new S[3*NC_];
+        Ws = new S[NC_*NC_];
+        signs_ = new S[NC_];
+        initial_signs_ = new S[NC_];
+
+        std::fill(initial_signs_, initial_signs_ + NC_, (S)0);
+        kurtosis_signs(data_, (S const *)NULL, Z, initial_signs_);
+        reset();
+    }
+
+    /* W0 = I, and restores the signs estimated on the whitened data, for a new optimization */
+    void reset(){
+        std::memset(W0,0,sizeof(T)*NC_*NC_);
+        for(int64_t i = 0 ; i < NC_ ; ++i)
+            W0[i*(NC_+1)] = 1;
+        logabsdet0_ = 0;
+        std::copy(initial_signs_, initial_signs_ + NC_, signs_);
+        sign_iterations_ = 0;
+    }
+
+    /* W0 = init, projected onto the orthogonal group in orthogonal mode, with the signs estimated at W0 */
+    void reset(T const * init){
+        if(orthogonal_){
+            //W0 = init*inv(sqrtm(init'*init))
+            kernels_.gemm(Trans,NoTrans,1,init,init,0,ELU);
+            detail::inv_sqrtm<T>(NC_,ELU,CAY);
+            kernels_.gemm(NoTrans,NoTrans,1,init,CAY,0,W0);
+        }
+        else
+            std::memcpy(W0, init, sizeof(T)*NC_*NC_);
+
+        std::memcpy(ELU, W0, sizeof(T)*NC_*NC_);
+        logabsdet0_ = kernels_.logabsdet(ELU);
+        resigns();
+        sign_iterations_ = 0;
+    }
+
+    /* Re-estimates the signs every interval iterations during the optimization (never if 0) */
+    void sign_interval(int64_t interval){
+        sign_interval_ = interval;
+    }
+
+    ~relative_log_likelihood(){
+        delete[] Z;
+        delete[] W0;
+        delete[] W;
+        delete[] ELU;
+        delete[] CAY;
+        delete[] phixT;
+        delete[] mu;
+        delete[] dphi_mean_;
+        delete[] zsq_mean_;
+        delete[] zphi_mean_;
+        delete[] chunk_means_;
+        delete[] Ws;
+        delete[] signs_;
+        delete[] initial_signs_;
+    }
+
+    T const * weights() const { return W0; }
+    bool orthogonal() const { return orthogonal_; }
+
+    bool resigns(){
+        convert(NC_*NC_, W0, Ws);
+        return kurtosis_signs(data_, (S const *)Ws, Z, signs_);
+    }
+
+    /* Value and relative gradient */
+    void operator()(VectorType const & x, T& value, VectorType & grad, umintl::value_gradient tag) const {
+        throw_if_mex_and_ctrl_c();
+
+        segments_t segs = segments(tag, data_.samples());
+        int64_t sample_size = total_size(segs);
+
+        //W = W0*(I+E) or W = W0*cayley(D)
+        T logabsdet = logabsdet0_ + transform(x, W);
+        convert(NC_*NC_, W, Ws);
+
+        //mu = mean(log p(Z)), phixT = 1/n*X'*Phi, with Z = X*W
+        std::fill(mu, mu + NC_, (T)0);
+        std::fill(dphi_mean_, dphi_mean_ + NC_, (T)0);
+        std::fill(zsq_mean_, zsq_mean_ + NC_, (T)0);
+        z_stats_.clear();
+        T beta = 0;
+        data_.for_each(segs, [&](S const * X, int64_t ld, int64_t len){
+            T weight = (T)len/sample_size;
+            S* phi = Z;
+            chunk_kernels_.project(len,X,ld,Ws,Z,LD_);
+            if(sign_interval_ > 0)
+                z_stats_.accumulate(len,(S const *)Z,LD_);
+            fn_->mu(0,len,Z,signs_,chunk_means_);
+            fn_->phi(0,len,Z,signs_,phi,chunk_means_+NC_,chunk_means_+2*NC_);
+            accumulate(NC_,weight,chunk_means_,mu);
+            accumulate(NC_,weight,chunk_means_+NC_,dphi_mean_);
+            accumulate(NC_,weight,chunk_means_+2*NC_,zsq_mean_);
+            product_(len,(T)1/sample_size,X,ld,phi,LD_,beta,phixT);
+            beta = 1;
+        });
+
+        //H = log(abs(det(W))) + sum(mu)
+        T H = logabsdet;
+        for(int64_t i = 0; i < NC_ ; ++i)
+            H+=mu[i];
+
+        //G = W'*(1/n*X'*Phi) - I = 1/n*Z'*Phi - I
+        kernels_.gemm(Trans,NoTrans,1,W,phixT,0,grad);
+        if(orthogonal_){
+            //G = (G - G')/2
+            for(int64_t i = 0 ; i < NC_ ; ++i){
+                zphi_mean_[i] = grad[i*(NC_+1)];
+                grad[i*(NC_+1)] = 0;
+                for(int64_t j = i+1 ; j < NC_ ; ++j){
+                    T gij = grad[i+j*NC_];
+                    T gji = grad[j+i*NC_];
+                    grad[i+j*NC_] = (gij - gji)/2;
+                    grad[j+i*NC_] = (gji - gij)/2;
+                }
+            }
+        }
+        else{
+            for(int64_t i = 0 ; i < NC_ ; ++i)
+                grad[i*(NC_+1)] -= 1;
+        }
+
+        value = -H;
+    }
+
+    /* Preconditioner : z = inv(H)*r, with H the block-diagonal approximation of the Hessian at the origin */
+    void operator()(VectorType const &, VectorType const & r, VectorType & z, umintl::hessian_preconditioner) const{
+        if(orthogonal_)
+            solve_skew_hessian_blocks(NC_, dphi_mean_, zsq_mean_, zphi_mean_, r, z);
+        else
+            solve_hessian_blocks(NC_, dphi_mean_, zsq_mean_, r, z);
+    }
+
+    /* W0 = W */
+    void operator()(VectorType const & x, umintl::rebase){
+        logabsdet0_ += transform(x, W);
+        std::memcpy(W0, W, sizeof(T)*NC_*NC_);
+    }
+
+    /* Every sign_interval iterations, re-estimates the signs from the statistics of Z recorded by the last value pass,
+     * at the accepted point. Returns true if any sign has changed */
+    bool operator()(VectorType const &, umintl::objective_update){
+        if(sign_interval_==0 || ++sign_iterations_ < sign_interval_)
+            return false;
+        sign_iterations_ = 0;
+        return kurtosis_signs(z_stats_, signs_);
+    }
+
+private:
+    /* res = W0*(I+E). Returns log(abs(det(I+E)))
+     * Orthogonal mode : res = W0*inv(I - D/2)*(I + D/2), with D = (E - E')/2. Returns 0 */
+    T transform(T const * E, T * res) const{
+        if(orthogonal_){
+            for(int64_t i = 0 ; i < NC_ ; ++i)
+                for(int64_t j = 0 ; j < NC_ ; ++j){
+                    T dij = (E[i+j*NC_] - E[j+i*NC_])/4;
+                    ELU[i+j*NC_] = ((i==j)?1:0) - dij;
+                    CAY[i+j*NC_] = ((i==j)?1:0) + dij;
+                }
+            kernels_.solve(ELU,CAY);
+            kernels_.gemm(NoTrans,NoTrans,1,W0,CAY,0,res);
+            return 0;
+        }
+
+        std::memcpy(res, W0, sizeof(T)*NC_*NC_);
+        kernels_.gemm(NoTrans,NoTrans,1,W0,E,1,res);
+
+        std::memcpy(ELU, E, sizeof(T)*NC_*NC_);
+        for(int64_t i = 0 ; i < NC_ ; ++i)
+            ELU[i*(NC_+1)] += 1;
+        return kernels_.logabsdet(ELU);
+    }
+
+    whitened_data<S> const & data_;
+    int64_t NC_;
+    int64_t LD_;
+    chunk_product<T, S> product_;
+    channel_kernels<T> kernels_;
+    channel_kernels<S> chunk_kernels_;
+    bool orthogonal_;
+
+    S* Z;
+    T* W0;
+    T* W;
+    T* ELU;
+    T* CAY;
+    T* phixT;
+    T* mu;
+    T* dphi_mean_;
+    T* zsq_mean_;
+    T* zphi_mean_;
+    S* chunk_means_;
+    S* Ws;
+    S* signs_;
+    S* initial_signs_;
+    T logabsdet0_;
+    int64_t sign_interval_;
+    int64_t sign_iterations_;
+    mutable tools::channel_statistics<S> z_stats_;
+
+    std::shared_ptr<dist_base<S>> fn_;
+};
+
+/* Relative objectives of P problems with K components, for umintl::lockstep_minimizer
+ *
+ * Each problem reads its K*K variables from the interleaved vectors, and evaluates its objective on its own data. */
+template<class T, class S>
+struct lockstep_relative_log_likelihood{
+    typedef unsigned char mask_type;
+
+    lockstep_relative_log_likelihood(std::vector<relative_log_likelihood<T, S>*> const & objectives, std::vector<int64_t> const & samples, int64_t N) :
+        objectives_(objectives), samples_(samples), N_(N), P_(objectives.size()), x_(N), r_(N), z_(N){ }
+
+    void operator()(T const * x, T * values, T * grads, mask_type const * mask){
+        for(int64_t k = 0 ; k < P_ ; ++k){
+            if(!mask[k])
+                continue;
+            T * xk = gather(x, k, x_);
+            T * gk = z_.data();
+            (*objectives_[k])(xk, values[k], gk, umintl::value_gradient(umintl::DETERMINISTIC, samples_[k], 0));
+            scatter(gk, k, grads);
+        }
+    }
+
+    void operator()(T const * x, T const * r, T * z, mask_type const * mask, umintl::hessian_preconditioner){
+        for(int64_t k = 0 ; k < P_ ; ++k){
+            if(!mask[k])
+                continue;
+            T * xk = gather(x, k, x_);
+            T * rk = gather(r, k, r_);
+            T * zk = z_.data();
+            (*objectives_[k])(xk, rk, zk, umintl::hessian_preconditioner(umintl::DETERMINISTIC, samples_[k], 0));
+            scatter(zk, k, z);
+        }
+    }
+
+    void operator()(T const * x, mask_type const * mask, umintl::rebase){
+        for(int64_t k = 0 ; k < P_ ; ++k){
+            if(!mask[k])
+                continue;
+            T * xk = gather(x, k, x_);
+            (*objectives_[k])(xk, umintl::rebase());
+        }
+    }
+
+    void operator()(T const * x, mask_type const * mask, mask_type * updated, umintl::objective_update){
+        for(int64_t k = 0 ; k < P_ ; ++k){
+            updated[k] = 0;
+            if(!mask[k])
+                continue;
+            T * xk = gather(x, k, x_);
+            updated[k] = (*objectives_[k])(xk, umintl::objective_update());
+        }
+    }
+
+private:
+    T * gather(T const * x, int64_t k, std::vector<T> & res) const{
+        for(int64_t i = 0 ; i < N_ ; ++i)
+            res[i] = x[i*P_ + k];
+        return res.data();
+    }
+
+    void scatter(T const * xk, int64_t k, T * x) const{
+        for(int64_t i = 0 ; i < N_ ; ++i)
+            x[i*P_ + k] = xk[i];
+    }
+
+    std::vector<relative_log_likelihood<T, S>*> objectives_;
+    std::vector<int64_t> samples_;
+    int64_t N_;
+    int64_t P_;
+    std::vector<T> x_;
+    std::vector<T> r_;
+    std::vector<T> z_;
 };
 
 template<class BackendType>
@@ -349,64 +925,534 @@ private:
 
 //lim = max(abs(abs(np.diag(fast_dot(W1, W.T))) - 1))
 
+/* Moves the whitened data to the storage precision. Returns the stored data */
+template<class T, class S>
+struct storage_cast{
+    static S * apply(std::vector<T> & data, std::vector<S> & stored){
+        stored.resize(data.size());
+        convert((int64_t)data.size(), data.data(), stored.data());
+        std::vector<T>().swap(data);
+        return stored.data();
+    }
+};
+
 template<class T>
-void ica(T const * data, T* Weights, T* Sphere, int64_t NC, int64_t DataNF, options const & conf){
+struct storage_cast<T, T>{
+    static T * apply(std::vector<T> & data, std::vector<T> &){
+        return data.data();
+    }
+};
+
+template<class T>
+class ica_engine<T>::impl{
+public:
+    impl(int64_t NC, int64_t NF, options const & opt) : NC_(NC), DataNF_(NF), opt_(opt), whitened_(false){
+        int64_t padsize = 4;
+        NK_ = (opt.pca_components > 0)?std::min<int64_t>(opt.pca_components, NC):NC;
+        NF_ = (DataNF_%padsize==0)?DataNF_:(DataNF_/padsize)*padsize;
+        means_.resize(NC_);
+        sphere_.resize(NK_*NC_);
+        weights_.resize(NK_*NK_);
+        set_options(opt);
+    }
+
+    virtual ~impl(){ }
+
+    virtual void whiten(T const * data, layout_type layout) = 0;
+    virtual void prepare() = 0;
+    /* Starts from the K*K weights W0, or from the identity if W0 is NULL */
+    virtual void fit(T const * W0) = 0;
+
+    /* res = W0 in the coordinates of the current sphere */
+    void initial_weights(T const * W0, init_type init, T * res) const{
+        if(!whitened_)
+            throw neo_ica::exception("ica_engine : fit() before whiten()");
+        if(init==WHITENED_INIT){
+            std::memcpy(res, W0, sizeof(T)*NK_*NK_);
+            return;
+        }
+        //res = U*S'*inv(S*S'), i.e., (S*S')*res' = S*U'
+        std::vector<T> G(NK_*NK_);
+        std::vector<typename backend<T>::size_t> ipiv(NK_+1);
+        backend<T>::gemm(Trans,NoTrans,NK_,NK_,NC_,1,sphere_.data(),NC_,sphere_.data(),NC_,0,G.data(),NK_);
+        backend<T>::gemm(Trans,NoTrans,NK_,NK_,NC_,1,sphere_.data(),NC_,W0,NC_,0,res,NK_);
+        backend<T>::getrf(NK_,NK_,G.data(),NK_,ipiv.data());
+        backend<T>::getrs(NoTrans,NK_,NK_,G.data(),NK_,ipiv.data(),res,NK_);
+    }
+
+    /* Keeps the options that shape the data */
+    void set_options(options const & opt){
+        options res(opt);
+        res.pca_components = opt_.pca_components;
+        res.block_size = opt_.block_size;
+        res.scratch = opt_.scratch;
+        res.storage = opt_.storage;
+        res.mixed_precision = opt_.mixed_precision;
+        res.fbatch = std::min(res.fbatch, (size_t)NF_);
+        if(res.fbatch==0)
+            res.fbatch = NF_;
+        opt_ = res;
+    }
+
+    /* sources = W*S*(data - means) */
+    void unmix(T const * data, T * sources, layout_type layout) const{
+        if(!whitened_)
+            throw neo_ica::exception("ica_engine : unmix() before whiten()");
+        std::vector<T> M(NC_*NK_);
+        backend<T>::gemm(NoTrans,NoTrans,NC_,NK_,NK_,1,sphere_.data(),NC_,weights_.data(),NK_,0,M.data(),NC_);
+        apply_sphere(NC_, NK_, DataNF_, DataNF_, data, means_.data(), (T const *)M.data(), (tools::permutation const *)NULL, sources, layout);
+    }
+
+    int64_t components() const { return NK_; }
+    T const * weights() const { return weights_.data(); }
+    T const * sphere() const { return sphere_.data(); }
+
+protected:
+    int64_t NC_;
+    int64_t DataNF_;
+    int64_t NK_;
+    int64_t NF_;
+    options opt_;
+    bool whitened_;
+    std::vector<T> means_;
+    std::vector<T> sphere_;
+    std::vector<T> weights_;
+};
+
+/* Engine with the whitened data and the NK*NF intermediates stored in S */
+template<class T, class S>
+class engine : public ica_engine<T>::impl{
+    typedef typename ica_engine<T>::impl base;
     typedef typename umintl_backend<T>::type BackendType;
 
-    options opt(conf);
+    using base::NC_;
+    using base::DataNF_;
+    using base::NK_;
+    using base::NF_;
+    using base::opt_;
+    using base::whitened_;
+    using base::means_;
+    using base::sphere_;
+    using base::weights_;
+
+    dist_base<S> * make_dist() const{
+        if(opt_.extended)
+            return new dist<S, extended_infomax>(NK_, white_->chunk_size());
+        return new dist<S, infomax>(NK_, white_->chunk_size());
+    }
+
+public:
+    engine(int64_t NC, int64_t NF, options const & opt) : base(NC, NF, opt), prepared_(false){ }
+
+    /* With a block size, the samples are random blocks instead of the leading points of a shuffled copy, for all the
+     * solvers.
+     * Out of core, the blocks of the scratch file are the sampling blocks, and only their content is shuffled */
+    void whiten(T const * data, layout_type layout){
+        int64_t padsize = 4;
+        compute_whitening(NC_, NK_, DataNF_, NF_, data, sphere_.data(), means_.data(), layout);
+        if(!opt_.scratch.empty()){
+            if(!scratch_.get()){
+                int64_t B = std::max<int64_t>(1024, ((4 << 20)/(sizeof(S)*NK_))/padsize*padsize);
+                scratch_.reset(new tools::scratch_file<S>(opt_.scratch, NK_, NF_, std::min(B, NF_)));
+                opt_.block_size = scratch_->block_size();
+            }
+            apply_sphere(NC_, NK_, DataNF_, NF_, data, (T const *)means_.data(), (T const *)sphere_.data(), *scratch_, layout);
+        }
+        else{
+            white_full_.resize(NK_*NF_);
+            std::unique_ptr<tools::permutation> perm;
+            if(opt_.block_size==0)
+                perm.reset(new tools::permutation(NF_));
+            apply_sphere(NC_, NK_, DataNF_, NF_, data, (T const *)means_.data(), (T const *)sphere_.data(), (tools::permutation const *)perm.get(), white_full_.data(), layout);
+        }
+        whitened_ = true;
+        prepared_ = false;
+    }
+
+    void prepare(){
+        if(!whitened_)
+            throw neo_ica::exception("ica_engine : prepare() before whiten()");
+        if(prepared_)
+            return;
+        if(scratch_.get())
+            white_.reset(new whitened_data<S>(*scratch_));
+        else{
+            S * stored = storage_cast<T, S>::apply(white_full_, white_stored_);
+            if(opt_.storage==STORE_FULL)
+                white_.reset(new whitened_data<S>(stored, NK_, NF_));
+            else{
+                //Tiles of about 256kB of decoded data
+                int64_t padsize = 4;
+                if(!codes_.get())
+                    codes_.reset(new tools::compressed_data<S>(opt_.storage, NK_, NF_));
+                codes_->encode(stored);
+                std::vector<T>().swap(white_full_);
+                std::vector<S>().swap(white_stored_);
+                white_.reset(new whitened_data<S>(*codes_, std::max<int64_t>(256, ((256 << 10)/(sizeof(S)*NK_))/padsize*padsize)));
+            }
+        }
+        newton_.reset();
+        relative_.reset();
+        prepared_ = true;
+    }
+
+    /* Objective of the relative solvers for the current options, W0 = I */
+    relative_log_likelihood<T, S> & relative_objective(){
+        prepare();
+        bool orthogonal = opt_.solver==ORTHOGONAL_LBFGS;
+        if(!relative_.get() || relative_extended_!=opt_.extended || relative_->orthogonal()!=orthogonal){
+            relative_.reset(new relative_log_likelihood<T, S>(*white_,make_dist(),orthogonal));
+            relative_extended_ = opt_.extended;
+        }
+        relative_->reset();
+        return *relative_;
+    }
+
+    int64_t samples() const { return NF_; }
+
+    void set_weights(T const * W){
+        std::memcpy(weights_.data(), W, sizeof(T)*NK_*NK_);
+    }
 
+    /* Sample sizes of the coarse levels of the multilevel schedule of the relative solvers, from the coarsest one */
+    std::vector<int64_t> coarse_levels() const{
+        std::vector<int64_t> res;
+        for(int64_t l = (int64_t)opt_.levels - 1 ; l > 0 ; --l){
+            int64_t n = NF_ >> std::min<int64_t>(2*l, 62);
+            if(n >= 32*NK_*NK_)
+                res.push_back(n);
+        }
+        return res;
+    }
+
+    void fit(T const * W0){
+        prepare();
+        int64_t N = NK_*NK_;
+        std::vector<T> buffer(N, 0);
+        T * X = buffer.data();
+        bool blocked = opt_.solver==NEWTON_CG && opt_.block_size > 0;
+
+        umintl::parameter_change_threshold<BackendType> stop(opt_.tol);
+
+        if(opt_.solver==RELATIVE_LBFGS || opt_.solver==ORTHOGONAL_LBFGS){
+            relative_log_likelihood<T, S> & objective = relative_objective();
+            if(W0)
+                objective.reset(W0);
+            //The signs follow the iterates inside the minimizer, and are checked on the whole data once it has converged
+            objective.sign_interval(opt_.extended?opt_.extblocks:0);
+
+            //Coarse levels, on a fixed subset of the samples. The origin of the objective carries the weights over
+            std::vector<int64_t> levels = coarse_levels();
+            for(size_t l = 0 ; l < levels.size() ; ++l){
+                umintl::minimizer<BackendType, umintl::low_memory_quasi_newton<BackendType>, umintl::backtracking<BackendType>
+                        , umintl::parameter_change_threshold<BackendType>, umintl::dynamically_sampled<BackendType> >
+                        coarse(umintl::low_memory_quasi_newton<BackendType>(7), umintl::backtracking<BackendType>()
+                               , umintl::parameter_change_threshold<BackendType>(opt_.tol*std::sqrt((double)NF_/levels[l]))
+                               , umintl::dynamically_sampled<BackendType>(opt_.rho,NF_,NF_,opt_.theta,opt_.block_size,levels[l])
+                               , opt_.iter, opt_.verbose);
+                std::memset(X,0,N*sizeof(T));
+                coarse(X,objective,X,N);
+            }
 
-    //Problem sizes
-    int64_t padsize = 4;
-    int64_t N = NC*NC;
-    int64_t NF=(DataNF%padsize==0)?DataNF:(DataNF/padsize)*padsize;
-    opt.fbatch=std::min(opt.fbatch, (size_t)NF);
-    if(opt.fbatch==0)
-        opt.fbatch=NF;
+            umintl::minimizer<BackendType, umintl::low_memory_quasi_newton<BackendType>, umintl::backtracking<BackendType>
+                    , umintl::parameter_change_threshold<BackendType>, umintl::deterministic<BackendType> >
+                    minimizer(umintl::low_memory_quasi_newton<BackendType>(7), umintl::backtracking<BackendType>(), stop
+                              , umintl::deterministic<BackendType>(), opt_.iter, opt_.verbose);
+            do{
+                //E_0 = 0
+                std::memset(X,0,N*sizeof(T));
+                minimizer(X,objective,X,N);
+            }while(opt_.extended && objective.resigns());
+
+            //Copies into datastructures
+            std::memcpy(weights_.data(), objective.weights(),sizeof(T)*N);
+        }
+        else{
+            if(!newton_.get() || newton_extended_!=opt_.extended){
+                newton_.reset(new log_likelihood<T, S>(*white_,make_dist()));
+                newton_extended_ = opt_.extended;
+            }
+            log_likelihood<T, S> & objective = *newton_;
+            objective.reset();
+            objective.sign_interval(opt_.extended?opt_.extblocks:0);
+
+            //Initial guess W_0 = I, or the given one with the signs estimated there
+            if(W0){
+                std::memcpy(X, W0, sizeof(T)*N);
+                objective.resigns(X);
+            }
+            else{
+                for(int64_t i = 0 ; i < NK_; ++i)
+                    X[i*(NK_+1)] = 1;
+            }
 
-    //Allocate
-    T * white_data =  new T[NC*NF];
-    T * X = new T[N];
-    std::memset(X,0,N*sizeof(T));
+            umintl::minimizer<BackendType, umintl::truncated_newton<BackendType>, umintl::strong_wolfe_powell<BackendType>
+                    , umintl::parameter_change_threshold<BackendType>, umintl::dynamically_sampled<BackendType> >
+                    minimizer(umintl::truncated_newton<BackendType>(umintl::tag::truncated_newton::STOP_HV_VARIANCE)
+                              , umintl::strong_wolfe_powell<BackendType>(), stop
+                              , umintl::dynamically_sampled<BackendType>(opt_.rho,opt_.fbatch,NF_,opt_.theta,blocked?opt_.block_size:0)
+                              , opt_.iter, opt_.verbose);
+            minimizer.hessian_vector_product_computation = umintl::PROVIDED;
+            do{
+                minimizer(X,objective,X,N);
+            }while(opt_.extended && objective.resigns(X));
+
+            //Copies into datastructures
+            std::memcpy(weights_.data(), X,sizeof(T)*N);
+        }
+    }
 
-    //Whiten Data
-    whiten<T>(NC, DataNF, NF, data, Sphere, white_data);
-    shuffle(white_data,NC,NF);
+private:
+    bool prepared_;
+    std::vector<T> white_full_;
+    std::vector<S> white_stored_;
+    std::unique_ptr< tools::compressed_data<S> > codes_;
+    std::unique_ptr< tools::scratch_file<S> > scratch_;
+    std::unique_ptr< whitened_data<S> > white_;
+    std::unique_ptr< log_likelihood<T, S> > newton_;
+    bool newton_extended_;
+    std::unique_ptr< relative_log_likelihood<T, S> > relative_;
+    bool relative_extended_;
+};
 
-    //Objective
-    dist_base<T>* fn;
-    if(opt.extended)
-        fn = new dist<T, extended_infomax>(NC, NF);
+template<class T>
+ica_engine<T>::ica_engine(int64_t NC, int64_t NF, options const & opt){
+    if(opt.mixed_precision)
+        impl_ = new engine<T, float>(NC, NF, opt);
     else
-        fn = new dist<T, infomax>(NC, NF);
-    log_likelihood<T> objective(white_data,NF,NC,fn);
+        impl_ = new engine<T, T>(NC, NF, opt);
+}
+
+template<class T>
+ica_engine<T>::~ica_engine(){
+    delete impl_;
+}
+
+template<class T>
+void ica_engine<T>::whiten(T const * data, layout_type layout){
+    impl_->whiten(data, layout);
+}
+
+template<class T>
+void ica_engine<T>::prepare(){
+    impl_->prepare();
+}
+
+template<class T>
+void ica_engine<T>::fit(){
+    impl_->fit((T const *)NULL);
+}
+
+template<class T>
+void ica_engine<T>::fit(options const & opt){
+    impl_->set_options(opt);
+    impl_->fit((T const *)NULL);
+}
 
-    //Initial guess W_0 = I
-    for(int64_t i = 0 ; i < NC; ++i)
-        X[i*(NC+1)] = 1;
+template<class T>
+void ica_engine<T>::fit(T const * W0, init_type init){
+    std::vector<T> W(impl_->components()*impl_->components());
+    impl_->initial_weights(W0, init, W.data());
+    impl_->fit(W.data());
+}
+
+template<class T>
+void ica_engine<T>::fit(options const & opt, T const * W0, init_type init){
+    impl_->set_options(opt);
+    fit(W0, init);
+}
 
-    //Optimizer
-    umintl::minimizer<BackendType> minimizer;
-    minimizer.hessian_vector_product_computation = umintl::PROVIDED;
-    minimizer.model = new umintl::dynamically_sampled<BackendType>(opt.rho,opt.fbatch,NF,opt.theta);
+template<class T>
+void ica_engine<T>::unmix(T const * data, T * sources, layout_type layout) const{
+    impl_->unmix(data, sources, layout);
+}
 
-    minimizer.direction = new umintl::truncated_newton<BackendType>(umintl::tag::truncated_newton::STOP_HV_VARIANCE);
+template<class T>
+int64_t ica_engine<T>::components() const{
+    return impl_->components();
+}
+
+template<class T>
+T const * ica_engine<T>::weights() const{
+    return impl_->weights();
+}
+
+template<class T>
+T const * ica_engine<T>::sphere() const{
+    return impl_->sphere();
+}
+
+template<class T>
+void ica(T const * data, T* Weights, T* Sphere, int64_t NC, int64_t DataNF, layout_type layout, options const & opt){
+    ica_engine<T> engine(NC, DataNF, opt);
+    engine.whiten(data, layout);
+    engine.fit();
+    int64_t NK = engine.components();
+    std::memcpy(Weights, engine.weights(), sizeof(T)*NK*NK);
+    std::memcpy(Sphere, engine.sphere(), sizeof(T)*NK*NC);
+}
+
+template<class T>
+void ica(T const * data, T* Weights, T* Sphere, int64_t NC, int64_t DataNF, layout_type layout, T const * W0, init_type init, options const & opt){
+    ica_engine<T> engine(NC, DataNF, opt);
+    engine.whiten(data, layout);
+    engine.fit(W0, init);
+    int64_t NK = engine.components();
+    std::memcpy(Weights, engine.weights(), sizeof(T)*NK*NK);
+    std::memcpy(Sphere, engine.sphere(), sizeof(T)*NK*NC);
+}
+
+template<class T>
+void ica(T const * data, T* Weights, T* Sphere, int64_t NC, int64_t NF, options const & opt){
+    ica(data, Weights, Sphere, NC, NF, CHANNEL_MAJOR, opt);
+}
+
+/* Problems of ica_batch() solved together by the lockstep relative L-BFGS. Their evaluations alternate, so that the
+ * whitened data of each problem should stay in cache */
+static const int64_t lockstep_width = 16;
+static const int64_t lockstep_max_components = 8;
+static const int64_t lockstep_max_bytes = 256 << 10;
+
+template<class T>
+options problem_options(options const & opt, int64_t index){
+    options res(opt);
+    if(!opt.scratch.empty()){
+        std::ostringstream path;
+        path << opt.scratch << "." << index;
+        res.scratch = path.str();
+    }
+    return res;
+}
+
+/* Whitens each problem of the group, then minimizes all the relative objectives with one lockstep_minimizer. As in
+ * engine::fit, the signs are re-estimated every extblocks iterations, and the problems whose signs change are
+ * optimized again from their new weights */
+template<class T, class S>
+void lockstep_fit(std::vector< ica_problem<T> > const & problems, std::vector<int64_t> const & group, options const & opt){
+    int64_t P = group.size();
+    std::vector< std::unique_ptr< engine<T, S> > > engines(P);
+    std::vector< relative_log_likelihood<T, S>* > objectives(P);
+    std::vector<int64_t> samples(P);
+    for(int64_t k = 0 ; k < P ; ++k){
+        ica_problem<T> const & p = problems[group[k]];
+        engines[k].reset(new engine<T, S>(p.NC, p.NF, problem_options<T>(opt, group[k])));
+        engines[k]->whiten(p.data, p.layout);
+        objectives[k] = &engines[k]->relative_objective();
+        objectives[k]->sign_interval(opt.extended?opt.extblocks:0);
+        samples[k] = engines[k]->samples();
+    }
+    int64_t NK = engines[0]->components();
+    int64_t N = NK*NK;
+
+    umintl::lockstep_minimizer<T> minimizer(7, opt.iter, opt.tol);
     minimizer.verbose = opt.verbose;
-    minimizer.iter = opt.iter;
-    minimizer.stopping_criterion = new umintl::parameter_change_threshold<BackendType>(opt.tol);
-    do{
-        minimizer(X,objective,X,N);
-    }while(opt.extended && objective.resigns(X));
+    lockstep_relative_log_likelihood<T, S> objective(objectives, samples, N);
+    std::vector<T> X(N*P);
+    std::vector<unsigned char> mask(P, 1);
+    std::vector<umintl::optimization_result> results(P);
+    while(std::find(mask.begin(), mask.end(), 1)!=mask.end()){
+        //E_0 = 0
+        std::fill(X.begin(), X.end(), (T)0);
+        minimizer(X.data(), objective, N, P, mask.data(), results.data());
+        for(int64_t k = 0 ; k < P ; ++k)
+            mask[k] = mask[k] && opt.extended && objectives[k]->resigns();
+    }
 
-    //Copies into datastructures
-    std::memcpy(Weights, X,sizeof(T)*NC*NC);
+    for(int64_t k = 0 ; k < P ; ++k){
+        ica_problem<T> const & p = problems[group[k]];
+        engines[k]->set_weights(objectives[k]->weights());
+        std::memcpy(p.W, engines[k]->weights(), sizeof(T)*N);
+        std::memcpy(p.S, engines[k]->sphere(), sizeof(T)*NK*p.NC);
+    }
+}
 
-    delete[] X;
-    delete[] white_data;
+template<class T>
+void ica_batch(std::vector< ica_problem<T> > const & problems, options const & opt){
+    int64_t n = problems.size();
+    int nthreads = (opt.nthreads > 0)?opt.nthreads:omp_get_max_threads();
+
+    //Largest problems first, so that the last ones to be picked are short
+    std::vector<int64_t> order(n);
+    std::iota(order.begin(), order.end(), (int64_t)0);
+    std::stable_sort(order.begin(), order.end(), [&problems](int64_t i, int64_t j){
+        return problems[i].NC*problems[i].NC*problems[i].NF > problems[j].NC*problems[j].NC*problems[j].NF;
+    });
+
+    //With the relative solvers, the problems with few components are grouped by size for the lockstep minimizer.
+    //The others are solved one by one, as well as all of them with a coarse-to-fine schedule, which it does not run
+    bool lockstep = (opt.solver==RELATIVE_LBFGS || opt.solver==ORTHOGONAL_LBFGS) && opt.levels <= 1;
+    std::vector< std::vector<int64_t> > groups;
+    std::vector<int64_t> open(lockstep_max_components + 1, -1);
+    for(int64_t k = 0 ; k < n ; ++k){
+        int64_t NC = problems[order[k]].NC;
+        int64_t NK = (opt.pca_components > 0)?std::min<int64_t>(opt.pca_components, NC):NC;
+        bool small = NK <= lockstep_max_components && (int64_t)sizeof(T)*NK*problems[order[k]].NF <= lockstep_max_bytes;
+        if(!lockstep || !small){
+            groups.push_back(std::vector<int64_t>(1, order[k]));
+            continue;
+        }
+        if(open[NK] < 0 || (int64_t)groups[open[NK]].size()==lockstep_width){
+            open[NK] = groups.size();
+            groups.push_back(std::vector<int64_t>());
+        }
+        groups[open[NK]].push_back(order[k]);
+    }
+    int64_t ngroups = groups.size();
+
+    std::exception_ptr error;
+    #pragma omp parallel num_threads(nthreads)
+    {
+        //The parallel regions of the kernels run on this thread only
+        omp_set_num_threads(1);
+        #pragma omp for schedule(dynamic, 1)
+        for(int64_t g = 0 ; g < ngroups ; ++g){
+            try{
+                std::vector<int64_t> const & group = groups[g];
+                if(group.size() > 1){
+                    if(opt.mixed_precision)
+                        lockstep_fit<T, float>(problems, group, opt);
+                    else
+                        lockstep_fit<T, T>(problems, group, opt);
+                }
+                else{
+                    ica_problem<T> const & p = problems[group[0]];
+                    ica(p.data, p.W, p.S, p.NC, p.NF, p.layout, problem_options<T>(opt, group[0]));
+                }
+            }
+            catch(...){
+                #pragma omp critical
+                if(!error)
+                    error = std::current_exception();
+            }
+        }
+    }
+    if(error)
+        std::rethrow_exception(error);
+}
+
+template<class T>
+void ica(std::string const & path, T* Weights, T* Sphere, int64_t NC, int64_t NF, layout_type layout, options const & opt, size_t offset){
+    tools::mapped_file file(path);
+    if(offset % sizeof(T) != 0)
+        throw neo_ica::exception("Offset in " + path + " is not a multiple of the size of a value");
+    //Compared in values, so that NC*NF cannot overflow
+    if(offset > file.size() || (NF > 0 && (uint64_t)NC > (file.size() - offset)/sizeof(T)/(uint64_t)NF))
+        throw neo_ica::exception("File " + path + " is too small for the given dimensions");
+    ica((T const *)(file.data() + offset), Weights, Sphere, NC, NF, layout, opt);
 }
 
 template void ica<float>(float const * data, float* Weights, float* Sphere, int64_t NC, int64_t NF, neo_ica::options const & opt);
 template void ica<double>(double const * data, double* Weights, double* Sphere, int64_t NC, int64_t NF, neo_ica::options const & opt);
+template void ica<float>(float const * data, float* Weights, float* Sphere, int64_t NC, int64_t NF, layout_type layout, neo_ica::options const & opt);
+template void ica<double>(double const * data, double* Weights, double* Sphere, int64_t NC, int64_t NF, layout_type layout, neo_ica::options const & opt);
+template void ica<float>(std::string const & path, float* Weights, float* Sphere, int64_t NC, int64_t NF, layout_type layout, neo_ica::options const & opt, size_t offset);
+template void ica<double>(std::string const & path, double* Weights, double* Sphere, int64_t NC, int64_t NF, layout_type layout, neo_ica::options const & opt, size_t offset);
+template void ica<float>(float const * data, float* Weights, float* Sphere, int64_t NC, int64_t NF, layout_type layout, float const * W0, init_type init, neo_ica::options const & opt);
+template void ica_batch<float>(std::vector< ica_problem<float> > const & problems, neo_ica::options const & opt);
+template void ica_batch<double>(std::vector< ica_problem<double> > const & problems, neo_ica::options const & opt);
+template void ica<double>(double const * data, double* Weights, double* Sphere, int64_t NC, int64_t NF, layout_type layout, double const * W0, init_type init, neo_ica::options const & opt);
+template class ica_engine<float>;
+template class ica_engine<double>;
 
 }
 
@@ -85,8 +85,44 @@ void fill_options(mxArray* options_mx, neo_ica_options_type & options){
         options.opts.nthreads = (int)mxGetScalar(nthreads);
     if(mxArray * extended = mxGetField(options_mx,0,"extended"))
         options.opts.extended = (bool)mxGetScalar(extended);
+    if(mxArray * extblocks = mxGetField(options_mx,0,"extblocks"))
+        options.opts.extblocks = (size_t)mxGetScalar(extblocks);
+    if(mxArray * levels = mxGetField(options_mx,0,"levels"))
+        options.opts.levels = (size_t)mxGetScalar(levels);
     if(mxArray * tol = mxGetField(options_mx, 0, "tol"))
         options.opts.tol = mxGetScalar(tol);
+    if(mxArray * block_size = mxGetField(options_mx, 0, "block_size"))
+        options.opts.block_size = (size_t)mxGetScalar(block_size);
+    if(mxArray * pca_components = mxGetField(options_mx, 0, "pca_components"))
+        options.opts.pca_components = (size_t)mxGetScalar(pca_components);
+    if(mxArray * mixed_precision = mxGetField(options_mx, 0, "mixed_precision"))
+        options.opts.mixed_precision = (bool)mxGetScalar(mixed_precision);
+    if(mxArray * solver = mxGetField(options_mx, 0, "solver")){
+        char * str = mxArrayToString(solver);
+        if(str && are_string_equal(str, "lbfgs"))
+            options.opts.solver = neo_ica::RELATIVE_LBFGS;
+        else if(str && are_string_equal(str, "orthogonal"))
+            options.opts.solver = neo_ica::ORTHOGONAL_LBFGS;
+        else
+            options.opts.solver = neo_ica::NEWTON_CG;
+        mxFree(str);
+    }
+    if(mxArray * scratch = mxGetField(options_mx, 0, "scratch")){
+        char * str = mxArrayToString(scratch);
+        if(str)
+            options.opts.scratch = str;
+        mxFree(str);
+    }
+    if(mxArray * storage = mxGetField(options_mx, 0, "storage")){
+        char * str = mxArrayToString(storage);
+        if(str && are_string_equal(str, "int16"))
+            options.opts.storage = neo_ica::STORE_INT16;
+        else if(str && are_string_equal(str, "bfloat16"))
+            options.opts.storage = neo_ica::STORE_BFLOAT16;
+        else
+            options.opts.storage = neo_ica::STORE_FULL;
+        mxFree(str);
+    }
 }
 
 void printErrorExit(std::string const & str){
@@ -122,13 +158,14 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     const mwSize * dims = mxGetDimensions(prhs[0]);
     size_t NC = static_cast<size_t>(dims[0]);
     size_t NF = static_cast<size_t>(dims[1]);
+    size_t NK = (options.opts.pca_components > 0 && options.opts.pca_components < NC)?options.opts.pca_components:NC;
 
     double * weights = NULL;
-    plhs[0] = mxCreateDoubleMatrix(NC,NC,mxREAL);
+    plhs[0] = mxCreateDoubleMatrix(NK,NK,mxREAL);
     weights = mxGetPr(plhs[0]);
 
     double * sphere = NULL;
-    plhs[1] = mxCreateDoubleMatrix(NC,NC,mxREAL);
+    plhs[1] = mxCreateDoubleMatrix(NK,NC,mxREAL);
     sphere = mxGetPr(plhs[1]);
 
 
@@ -139,25 +176,25 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 
         neo_ica::ica(data, weights, sphere, NC, NF, options.opts);
 
-        transpose(weights,NC,NC);
-        transpose(sphere,NC,NC);
+        transpose(weights,NK,NK);
+        transpose(sphere,NC,NK);
         transpose(data,NF,NC);
     }
     else{
         //Get data
         float * data = (float*)mxGetPr(prhs[0]);
-        float * weights_float = new float[NC*NC];
-        float * sphere_float = new float[NC*NC];
+        float * weights_float = new float[NK*NK];
+        float * sphere_float = new float[NC*NK];
         transpose(data,NC,NF);
 
         neo_ica::ica(data, weights_float, sphere_float, NC, NF, options.opts);
 
-        for(size_t i = 0 ; i < NC ; ++i){
-            for(size_t j = 0 ; j < NC ; ++j){
-                weights[i*NC+j] = weights_float[j*NC+i];
-                sphere[i*NC+j] = sphere_float[j*NC+i];
-            }
-        }
+        for(size_t i = 0 ; i < NK ; ++i)
+            for(size_t j = 0 ; j < NK ; ++j)
+                weights[i*NK+j] = weights_float[j*NK+i];
+        for(size_t c = 0 ; c < NC ; ++c)
+            for(size_t k = 0 ; k < NK ; ++k)
+                sphere[c*NK+k] = sphere_float[k*NC+c];
 
         transpose(data,NF,NC);
         delete[] weights_float;
@@ -4,14 +4,19 @@ import numpy as np
 
 def ica(data, iter=df.iter, verbose=df.verbose, nthreads=df.nthreads,
         rho=df.rho, fbatch=df.fbatch, theta=df.theta, extended=df.extended, 
-        tol=df.tol):
+        tol=df.tol, solver=df.solver, block_size=df.block_size,
+        pca_components=df.pca_components, scratch=df.scratch,
+        storage=df.storage, mixed_precision=df.mixed_precision,
+        extblocks=df.extblocks, levels=df.levels):
     
     X = np.ascontiguousarray(data)
     NC = X.shape[0]
-    weights = np.empty((NC, NC), dtype=X.dtype)
-    sphere = np.empty((NC, NC), dtype=X.dtype)
+    K = pca_components if 0 < pca_components < NC else NC
+    weights = np.empty((K, K), dtype=X.dtype)
+    sphere = np.empty((K, NC), dtype=X.dtype)
     _ica.ica(data, weights, sphere, iter, verbose, 
-                    nthreads, rho, fbatch, theta, extended, tol)
+                    nthreads, rho, fbatch, theta, extended, tol, solver, block_size,
+                    pca_components, scratch, storage, mixed_precision, extblocks, levels)
     W = np.dot(weights, sphere)
     sources = np.dot(W, data)
     return sources, W
@@ -6,10 +6,20 @@
 namespace py = pybind11;
 
 std::tuple<py::array, py::array> ica(py::array& data, py::array& weights, py::array& sphere,
-         int iter, unsigned int verbose, int nthreads, double rho, int fbatch, double theta, bool extended, double tol)
+         int iter, unsigned int verbose, int nthreads, double rho, int fbatch, double theta, bool extended, double tol, std::string const & solver, int block_size, int pca_components, std::string const & scratch, std::string const & storage, bool mixed_precision, int extblocks, int levels)
 {
     //options
-    neo_ica::options opt(iter, verbose, theta, rho, fbatch, nthreads, extended, tol);
+    neo_ica::solver_type solver_id = neo_ica::NEWTON_CG;
+    if(solver=="lbfgs")
+        solver_id = neo_ica::RELATIVE_LBFGS;
+    else if(solver=="orthogonal")
+        solver_id = neo_ica::ORTHOGONAL_LBFGS;
+    neo_ica::storage_type storage_id = neo_ica::STORE_FULL;
+    if(storage=="int16")
+        storage_id = neo_ica::STORE_INT16;
+    else if(storage=="bfloat16")
+        storage_id = neo_ica::STORE_BFLOAT16;
+    neo_ica::options opt(iter, verbose, theta, rho, fbatch, nthreads, extended, tol, solver_id, block_size, pca_components, scratch, storage_id, mixed_precision, extblocks, levels);
     //buffer
     py::buffer_info const & X = data.request();
     py::buffer_info const & W = weights.request();
@@ -36,7 +46,11 @@ PYBIND11_PLUGIN(_ica) {
           py::arg("iter"), py::arg("verbose"),
           py::arg("nthreads"), py::arg("rho"),
           py::arg("fbatch"), py::arg("theta"),
-          py::arg("extended"), py::arg("tol"));
+          py::arg("extended"), py::arg("tol"),
+          py::arg("solver"), py::arg("block_size"),
+          py::arg("pca_components"), py::arg("scratch"),
+          py::arg("storage"), py::arg("mixed_precision"),
+          py::arg("extblocks"), py::arg("levels"));
 
     py::module df = m.def_submodule("default", "Default values for parameters");
     using namespace neo_ica::dflt;
@@ -48,5 +62,13 @@ PYBIND11_PLUGIN(_ica) {
     df.attr("theta") = py::float_(theta);
     df.attr("extended") = py::bool_(extended);
     df.attr("tol") = py::float_(tol);
+    df.attr("solver") = py::str((solver==neo_ica::RELATIVE_LBFGS)?"lbfgs":"newton");
+    df.attr("block_size") = py::int_(block_size);
+    df.attr("pca_components") = py::int_(pca_components);
+    df.attr("scratch") = py::str(scratch);
+    df.attr("mixed_precision") = py::bool_(mixed_precision);
+    df.attr("extblocks") = py::int_(extblocks);
+    df.attr("levels") = py::int_(levels);
+    df.attr("storage") = py::str((storage==neo_ica::STORE_INT16)?"int16":(storage==neo_ica::STORE_BFLOAT16)?"bfloat16":"full");
     return m.ptr();
 }
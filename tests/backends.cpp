@@ -0,0 +1,102 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* Fused operations of the BLAS backend : waxpby with aliasing, axpy_dot, diff_dot and dot accumulated in double in
+ * single precision, and diff_nrm2 on differences whose squares overflow or underflow */
+
+#include "test-utils.hpp"
+
+#include <limits>
+
+#include "neo_ica/backend/backend.hpp"
+#include "umintl/backends/fused.hpp"
+
+static const int64_t N = 1000;
+
+template<class T>
+void test(T huge, T tiny){
+    typedef umintl::backend::blas_types<T> BackendType;
+    typedef umintl::backend::fused<BackendType> fused;
+    typedef typename BackendType::VectorType VectorType;
+
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<double> unif(-1, 1);
+    std::vector<T> x(N), y(N), z(N);
+    for(int64_t i = 0 ; i < N ; ++i){
+        //Equal pairs of x and y against opposite pairs of z : y'z is tiny with respect to its terms
+        x[i] = (i%2)?x[i-1]:(T)unif(gen);
+        y[i] = (i%2)?y[i-1]:(T)unif(gen);
+        z[i] = (T)(1e4*((i%2)?-1:1) + unif(gen));
+    }
+    VectorType X = x.data(), Y = y.data(), Z = z.data();
+
+    //w = 2x - 3y, into a third vector, x and y
+    std::vector<T> ref(N), w(N);
+    for(int64_t i = 0 ; i < N ; ++i)
+        ref[i] = 2*x[i] - 3*y[i];
+    VectorType W = w.data();
+    fused::waxpby(N, 2, X, -3, Y, W);
+    CHECK(relative_error(N, W, ref.data()) == 0);
+    std::vector<T> xa(x), ya(y);
+    VectorType XA = xa.data(), YA = ya.data();
+    fused::waxpby(N, 2, XA, -3, Y, XA);
+    fused::waxpby(N, 2, X, -3, YA, YA);
+    CHECK(relative_error(N, XA, ref.data()) == 0);
+    CHECK(relative_error(N, YA, ref.data()) == 0);
+
+    //y = y + 0.5x ; y'z, against a double precision reference, and the same as dot
+    double dot = 0, dotabs = 0;
+    for(int64_t i = 0 ; i < N ; ++i){
+        ya[i] = y[i] + (T)0.5*x[i];
+        dot += (double)ya[i]*z[i];
+        dotabs += std::abs((double)ya[i]*z[i]);
+    }
+    //Rounded once to T, up to the rounding errors of a double precision sum
+    double tol = 4*std::numeric_limits<T>::epsilon()*std::abs(dot) + N*std::numeric_limits<double>::epsilon()*dotabs;
+    std::vector<T> yb(y);
+    VectorType YB = yb.data();
+    T res = fused::axpy_dot(N, 0.5, X, YB, Z);
+    CHECK(relative_error(N, YB, YA) == 0);
+    CHECK(std::abs(res - dot) <= tol);
+    CHECK(std::abs(BackendType::dot(N, YB, Z) - dot) <= tol);
+
+    //z'(x - y), against a double precision reference
+    double diff = 0, diffabs = 0;
+    for(int64_t i = 0 ; i < N ; ++i){
+        diff += ((double)x[i] - y[i])*z[i];
+        diffabs += std::abs(((double)x[i] - y[i])*z[i]);
+    }
+    tol = 4*std::numeric_limits<T>::epsilon()*std::abs(diff) + N*std::numeric_limits<double>::epsilon()*diffabs;
+    CHECK(std::abs(fused::diff_dot(N, X, Y, Z) - diff) <= tol);
+    CHECK(fused::diff_dot(N, X, X, Z) == 0);
+
+    //norm2(x - y) : plain, with squares that overflow, and with squares that underflow
+    double nrm = 0;
+    for(int64_t i = 0 ; i < N ; ++i)
+        nrm += ((double)x[i] - y[i])*((double)x[i] - y[i]);
+    nrm = std::sqrt(nrm);
+    T scales[] = {1, huge, tiny};
+    for(T s : scales){
+        std::vector<T> xs(N), ys(N);
+        for(int64_t i = 0 ; i < N ; ++i){
+            xs[i] = x[i]*s;
+            ys[i] = y[i]*s;
+        }
+        VectorType XS = xs.data(), YS = ys.data();
+        double expected = nrm*(double)s;
+        CHECK(std::abs(fused::diff_nrm2(N, XS, YS) - expected) <= 1e-5*expected);
+    }
+    CHECK(fused::diff_nrm2(N, X, X) == 0);
+}
+
+int main(){
+    test<float>(1e30f, 1e-30f);
+    test<double>(1e200, 1e-200);
+    return test_result();
+}
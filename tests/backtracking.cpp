@@ -0,0 +1,96 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* Every step accepted by the backtracking line search meets the Armijo condition, and is the longest of the trial
+ * steps 1, shrink, shrink^2... that does */
+
+#include "test-utils.hpp"
+
+#include "neo_ica/backend/backend.hpp"
+#include "umintl/minimize.hpp"
+#include "umintl/line_search/backtracking.hpp"
+
+typedef double ScalarType;
+typedef umintl::backend::blas_types<ScalarType> BackendType;
+typedef BackendType::VectorType VectorType;
+
+static const int64_t N = 10;
+static const ScalarType c1 = 1e-4;
+static const ScalarType shrink = 0.5;
+
+/* Extended Rosenbrock function, on which the unit step of the first iterations overshoots */
+struct rosenbrock{
+    void operator()(VectorType const & x, ScalarType & value, VectorType & grad, umintl::value_gradient) const{
+        value = 0;
+        std::fill(grad, grad + N, 0);
+        for(int64_t i = 0 ; i + 1 < N ; ++i){
+            ScalarType a = x[i+1] - x[i]*x[i], b = 1 - x[i];
+            value += 100*a*a + b*b;
+            grad[i] += -400*a*x[i] - 2*b;
+            grad[i+1] += 200*a;
+        }
+    }
+};
+
+/* Never stops : checks the step of each iteration */
+struct check_armijo : public umintl::stopping_criterion<BackendType>{
+    check_armijo(rosenbrock * _fun, int * _steps, int * _shrunk) : fun(_fun), steps(_steps), shrunk(_shrunk){ }
+
+    bool operator()(umintl::optimization_context<BackendType> & c){
+        ScalarType alpha = c.alpha();
+        CHECK(c.dphi_0() < 0);
+        CHECK(alpha > 0 && alpha <= 1);
+        CHECK(c.val() <= c.valm1() + c1*alpha*c.dphi_0());
+
+        //x = xm1 + alpha*p
+        std::vector<ScalarType> trial(N), g(N);
+        for(int64_t i = 0 ; i < N ; ++i)
+            trial[i] = c.xm1()[i] + alpha*c.p()[i];
+        CHECK(relative_error(N, c.x(), trial.data()) < 1e-14);
+
+        //The previous trial step, if any, was rejected
+        if(alpha < 1){
+            ScalarType value;
+            VectorType T = trial.data(), G = g.data();
+            for(int64_t i = 0 ; i < N ; ++i)
+                T[i] = c.xm1()[i] + alpha/shrink*c.p()[i];
+            (*fun)(T, value, G, umintl::value_gradient(umintl::DETERMINISTIC, 0, 0));
+            CHECK(value > c.valm1() + c1*alpha/shrink*c.dphi_0());
+            ++*shrunk;
+        }
+        ++*steps;
+        return false;
+    }
+
+    rosenbrock * fun;
+    int * steps;
+    int * shrunk;
+};
+
+template<class DirectionType>
+void test(DirectionType const & direction){
+    rosenbrock fun;
+    int steps = 0, shrunk = 0;
+    umintl::minimizer<BackendType, DirectionType, umintl::backtracking<BackendType>, check_armijo, umintl::deterministic<BackendType> >
+            minimizer(direction, umintl::backtracking<BackendType>(40, c1, shrink), check_armijo(&fun, &steps, &shrunk)
+                      , umintl::deterministic<BackendType>(), 200);
+    std::vector<ScalarType> x0(N, -1), x(N);
+    x0[0] = -1.2;
+    VectorType X = x.data(), X0 = x0.data();
+    minimizer(X, fun, X0, N);
+    //Some steps were accepted, and some of them only after backtracking
+    CHECK(steps > 0);
+    CHECK(shrunk > 0);
+}
+
+int main(){
+    test(umintl::steepest_descent<BackendType>());
+    test(umintl::low_memory_quasi_newton<BackendType>(4));
+    return test_result();
+}
@@ -0,0 +1,85 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* ica_batch, through the lockstep minimizer or one problem at a time, gives the same weights and sphere as ica() on
+ * each problem. Problems with more than 8 components or too much data for the lockstep minimizer, and all the problems
+ * of the other solvers, are solved one by one alongside the lockstep groups */
+
+#include "test-utils.hpp"
+
+typedef double ScalarType;
+typedef std::vector< std::pair<int64_t, int64_t> > shapes_type;
+
+void test(neo_ica::options const & opt, double tol, shapes_type const & shapes){
+    int64_t nproblems = shapes.size();
+    std::vector< std::vector<ScalarType> > data(nproblems), W(nproblems), S(nproblems);
+    std::vector< neo_ica::ica_problem<ScalarType> > problems;
+    for(int64_t k = 0 ; k < nproblems ; ++k){
+        //In both layouts
+        int64_t NC = shapes[k].first, NF = shapes[k].second;
+        neo_ica::layout_type layout = (k%3)?neo_ica::CHANNEL_MAJOR:neo_ica::SAMPLE_MAJOR;
+        data[k] = mixture<ScalarType>(NC, NC, NF, k);
+        if(layout==neo_ica::SAMPLE_MAJOR)
+            data[k] = transpose(data[k], NC, NF);
+        W[k].resize(NC*NC);
+        S[k].resize(NC*NC);
+        problems.push_back(neo_ica::ica_problem<ScalarType>(data[k].data(), W[k].data(), S[k].data(), NC, NF, layout));
+    }
+    neo_ica::ica_batch(problems, opt);
+
+    for(int64_t k = 0 ; k < nproblems ; ++k){
+        neo_ica::ica_problem<ScalarType> const & p = problems[k];
+        std::vector<ScalarType> Wref(p.NC*p.NC), Sref(p.NC*p.NC);
+        neo_ica::ica(p.data, Wref.data(), Sref.data(), p.NC, p.NF, p.layout, opt);
+        //Problems that cannot be solved in lockstep follow the same path as ica()
+        bool solo = p.NC > 8 || (int64_t)sizeof(ScalarType)*p.NC*p.NF > (256 << 10);
+        CHECK(relative_error(p.NC*p.NC, p.W, Wref.data()) < (solo?1e-10:tol));
+        CHECK(relative_error(p.NC*p.NC, p.S, Sref.data()) < 1e-10);
+    }
+}
+
+int main(){
+    neo_ica::options opt;
+    opt.solver = neo_ica::RELATIVE_LBFGS;
+    opt.tol = 1e-10;
+
+    //Two groups of sizes
+    shapes_type small;
+    for(int64_t k = 0 ; k < 7 ; ++k)
+        small.push_back(std::make_pair(3 + k%2, 2000 + 100*k));
+
+    //Lockstep, with the signs re-estimated inside the optimization, once it has converged, or fixed. The iterates only
+    //differ by rounding, but the minimum is flat : the last steps stop at slightly different points
+    test(opt, 1e-4, small);
+    opt.extblocks = 0;
+    test(opt, 1e-4, small);
+    opt.extended = false;
+    test(opt, 1e-4, small);
+
+    //One problem at a time, along the same path as ica()
+    opt.extended = true;
+    opt.levels = 2;
+    test(opt, 1e-10, small);
+    opt.levels = 1;
+    neo_ica::solver_type solvers[] = {neo_ica::NEWTON_CG, neo_ica::ORTHOGONAL_LBFGS};
+    for(neo_ica::solver_type solver : solvers){
+        opt.solver = solver;
+        test(opt, (solver==neo_ica::NEWTON_CG)?1e-10:1e-4, small);
+    }
+
+    //Lockstep groups, mixed with problems of 10 channels and with problems of more than 256KB, solved one by one
+    shapes_type mixed(small);
+    mixed.push_back(std::make_pair(10, 3000));
+    mixed.push_back(std::make_pair(10, 4000));
+    mixed.push_back(std::make_pair(3, 12000));
+    mixed.push_back(std::make_pair(4, 9000));
+    opt.solver = neo_ica::RELATIVE_LBFGS;
+    test(opt, 1e-4, mixed);
+    return test_result();
+}
@@ -0,0 +1,91 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* compressed_data round trips : 16-bit integers within half a quantization step of each channel, including a constant
+ * channel, and bfloat16 within half a unit in the last place, rounded to nearest even. Decoding a range of samples into
+ * a larger leading dimension gives the same values as decoding everything, and writes nothing else */
+
+#include "test-utils.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "neo_ica/tools/compressed.hpp"
+
+static const int64_t NC = 5;
+static const int64_t NF = 3001;
+
+template<class T>
+void test(){
+    typedef neo_ica::tools::compressed_data<T> compressed;
+    std::mt19937 gen(7);
+    std::normal_distribution<double> normal(0, 1);
+
+    //Channels of very different scales and offsets, and a constant one
+    std::vector<T> X(NC*NF);
+    for(int64_t c = 0 ; c < NC ; ++c)
+        for(int64_t f = 0 ; f < NF ; ++f)
+            X[c*NF + f] = (c==2)?(T)-3.25:(T)(std::pow(10., c - 2)*normal(gen) + 100*c);
+
+    neo_ica::storage_type storages[] = {neo_ica::STORE_INT16, neo_ica::STORE_BFLOAT16};
+    for(neo_ica::storage_type storage : storages){
+        compressed data(storage, NC, NF);
+        CHECK(data.channels()==NC);
+        CHECK(data.samples()==NF);
+        data.encode(X.data());
+        std::vector<T> Y(NC*NF);
+        data.decode(0, NF, Y.data(), NF);
+
+        bool bounded = true;
+        for(int64_t c = 0 ; c < NC ; ++c){
+            T const * x = &X[c*NF];
+            T const * y = &Y[c*NF];
+            T lo = *std::min_element(x, x + NF);
+            T hi = *std::max_element(x, x + NF);
+            for(int64_t f = 0 ; f < NF ; ++f){
+                double err = std::abs((double)x[f] - y[f]);
+                if(storage==neo_ica::STORE_INT16)
+                    bounded &= err <= 0.5*(hi - lo)/65534*(1 + 1e-3) + 4*std::numeric_limits<T>::epsilon()*std::max(std::abs(hi), std::abs(lo));
+                else
+                    bounded &= err <= std::ldexp(std::abs((double)x[f]), -8);
+            }
+        }
+        CHECK(bounded);
+        //Exact on the constant channel
+        CHECK(relative_error(NF, &Y[2*NF], &X[2*NF]) == 0);
+
+        //A range in the middle of the channels, into a larger leading dimension filled with guard values
+        int64_t first = 300, len = 1000, ld = len + 7;
+        T guard = 12345;
+        std::vector<T> Z(NC*ld, guard);
+        data.decode(first, len, Z.data(), ld);
+        bool untouched = true;
+        for(int64_t c = 0 ; c < NC ; ++c){
+            CHECK(relative_error(len, &Z[c*ld], &Y[c*NF + first]) == 0);
+            for(int64_t f = len ; f < ld ; ++f)
+                untouched &= Z[c*ld + f]==guard;
+        }
+        CHECK(untouched);
+    }
+
+    //bfloat16 ties go to the even mantissa
+    T ties[] = {(T)(1 + std::ldexp(1., -8)), (T)(1 + 3*std::ldexp(1., -8)), (T)-(1 + 3*std::ldexp(1., -8))};
+    T rounded[] = {1, (T)(1 + std::ldexp(1., -6)), (T)-(1 + std::ldexp(1., -6))};
+    compressed data(neo_ica::STORE_BFLOAT16, 1, 3);
+    data.encode(ties);
+    T Y[3];
+    data.decode(0, 3, Y, 3);
+    CHECK(relative_error(3, Y, rounded) == 0);
+}
+
+int main(){
+    test<float>();
+    test<double>();
+    return test_result();
+}
@@ -0,0 +1,72 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* ica_engine with fewer principal components than channels, in both layouts : shapes of the weights, sphere and
+ * sources, and unmix() writes exactly K*NF values */
+
+#include "test-utils.hpp"
+
+typedef double ScalarType;
+static const int64_t NC = 12;
+static const int64_t K = 3;
+static const int64_t NF = 10001;
+static const ScalarType guard = 12345;
+
+int main(){
+    std::vector<ScalarType> data = mixture<ScalarType>(NC, K, NF);
+    std::vector<ScalarType> samples = transpose(data, NC, NF);
+
+    neo_ica::options opt;
+    opt.solver = neo_ica::RELATIVE_LBFGS;
+    opt.pca_components = K;
+
+    std::vector<ScalarType> sources[2];
+    neo_ica::layout_type layouts[] = {neo_ica::CHANNEL_MAJOR, neo_ica::SAMPLE_MAJOR};
+    for(int l = 0 ; l < 2 ; ++l){
+        ScalarType const * X = (layouts[l]==neo_ica::CHANNEL_MAJOR)?data.data():samples.data();
+        neo_ica::ica_engine<ScalarType> engine(NC, NF, opt);
+        engine.whiten(X, layouts[l]);
+        engine.fit();
+        CHECK(engine.components()==K);
+
+        //Same weights and sphere as ica()
+        std::vector<ScalarType> W(K*K), S(K*NC);
+        neo_ica::ica(X, W.data(), S.data(), NC, NF, layouts[l], opt);
+        CHECK(relative_error(K*K, engine.weights(), W.data()) < 1e-12);
+        CHECK(relative_error(K*NC, engine.sphere(), S.data()) < 1e-12);
+
+        //K*NF sources, followed by untouched guard values
+        sources[l].assign(K*NF + NC*NF, guard);
+        engine.unmix(X, sources[l].data(), layouts[l]);
+        bool untouched = true;
+        for(int64_t i = K*NF ; i < (int64_t)sources[l].size() ; ++i)
+            untouched &= sources[l][i]==guard;
+        CHECK(untouched);
+
+        //Centered, with the covariance W*W' of the whitened data unmixed by W. The means and the sphere are estimated
+        //on the leading multiple of 4 samples only, hence the loose tolerances
+        for(int64_t k = 0 ; k < K ; ++k){
+            double mean = 0;
+            for(int64_t f = 0 ; f < NF ; ++f)
+                mean += sources[l][k*NF + f];
+            CHECK(std::abs(mean/NF) < 1e-3);
+        }
+        for(int64_t i = 0 ; i < K ; ++i)
+            for(int64_t j = 0 ; j < K ; ++j){
+                double cov = 0, ww = 0;
+                for(int64_t f = 0 ; f < NF ; ++f)
+                    cov += sources[l][i*NF + f]*sources[l][j*NF + f];
+                for(int64_t k = 0 ; k < K ; ++k)
+                    ww += W[i*K + k]*W[j*K + k];
+                CHECK(std::abs(cov/(NF-1) - ww) < 5e-3*std::max(1., std::abs(ww)));
+            }
+    }
+    CHECK(relative_error(K*NF, sources[1].data(), sources[0].data()) < 1e-6);
+    return test_result();
+}
@@ -0,0 +1,84 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* ica() on a raw binary file, after a header, gives the same weights and sphere as on the same data in memory, in both
+ * layouts. Offsets that are not a multiple of the size of a value, and dimensions beyond the end of the file, including
+ * ones whose product overflows, are rejected. With the whitened data streamed from a scratch file, block by block, the
+ * weights only differ by the order of the samples within the blocks */
+
+#include "test-utils.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <string>
+
+typedef float ScalarType;
+static const int64_t NC = 4;
+static const int64_t NF = 5000;
+static const size_t header = 3*sizeof(ScalarType);
+
+/* Writes header bytes followed by the NC*NF values of data */
+void write(std::string const & path, std::vector<ScalarType> const & data){
+    std::vector<char> zeros(header, 0);
+    FILE * f = std::fopen(path.c_str(), "wb");
+    std::fwrite(zeros.data(), 1, header, f);
+    std::fwrite(data.data(), sizeof(ScalarType), data.size(), f);
+    std::fclose(f);
+}
+
+bool throws(std::string const & path, int64_t nc, int64_t nf, size_t offset){
+    std::vector<ScalarType> W(NC*NC), S(NC*NC);
+    try{
+        neo_ica::ica(path, W.data(), S.data(), nc, nf, neo_ica::CHANNEL_MAJOR, neo_ica::options(), offset);
+    }
+    catch(std::exception const &){
+        return true;
+    }
+    return false;
+}
+
+int main(){
+    std::vector<ScalarType> data = mixture<ScalarType>(NC, NC, NF);
+    std::vector<ScalarType> samples = transpose(data, NC, NF);
+    std::string path = "test-file.raw";
+
+    neo_ica::options opt;
+    opt.solver = neo_ica::RELATIVE_LBFGS;
+    neo_ica::layout_type layouts[] = {neo_ica::CHANNEL_MAJOR, neo_ica::SAMPLE_MAJOR};
+    for(int l = 0 ; l < 2 ; ++l){
+        std::vector<ScalarType> const & X = (layouts[l]==neo_ica::CHANNEL_MAJOR)?data:samples;
+        write(path, X);
+        std::vector<ScalarType> W(NC*NC), S(NC*NC), Wref(NC*NC), Sref(NC*NC);
+        neo_ica::ica(path, W.data(), S.data(), NC, NF, layouts[l], opt, header);
+        neo_ica::ica(X.data(), Wref.data(), Sref.data(), NC, NF, layouts[l], opt);
+        CHECK(relative_error(NC*NC, W.data(), Wref.data()) == 0);
+        CHECK(relative_error(NC*NC, S.data(), Sref.data()) == 0);
+    }
+
+    //Scratch file of several blocks, read ahead while the previous block is used
+    neo_ica::options sopt(opt);
+    sopt.block_size = 512;
+    std::vector<ScalarType> W(NC*NC), S(NC*NC), Wref(NC*NC), Sref(NC*NC);
+    neo_ica::ica(data.data(), Wref.data(), Sref.data(), NC, NF, neo_ica::CHANNEL_MAJOR, sopt);
+    sopt.scratch = "test-file.scratch";
+    neo_ica::ica(data.data(), W.data(), S.data(), NC, NF, neo_ica::CHANNEL_MAJOR, sopt);
+    CHECK(relative_error(NC*NC, W.data(), Wref.data()) < 1e-4);
+    CHECK(relative_error(NC*NC, S.data(), Sref.data()) == 0);
+
+    CHECK(!throws(path, NC, NF, header));
+    CHECK(throws(path, NC, NF, header - 1));
+    CHECK(throws(path, NC, NF + 1, header));
+    CHECK(throws(path, NC, NF, header + sizeof(ScalarType)));
+    CHECK(throws(path, NC, NF, header + NC*NF*sizeof(ScalarType) + 2*sizeof(ScalarType)));
+    //sizeof(ScalarType)*NC*NF wraps around to 0
+    CHECK(throws(path, (int64_t)1 << 31, (int64_t)1 << 31, header));
+    CHECK(throws("test-file.missing", NC, NF, 0));
+    std::remove(path.c_str());
+    return test_result();
+}
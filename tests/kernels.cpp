@@ -0,0 +1,110 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* fixed_size channel kernels against BLAS and LAPACK, for every number of channels they are selected for : projection
+ * and cross product of chunks with leading dimensions larger than the chunk, products with and without transposes,
+ * Gauss-Jordan inverse and log-determinant, and the solve of the Cayley transform, on a matrix that needs pivoting */
+
+#include "test-utils.hpp"
+
+#include "neo_ica/backend/backend.hpp"
+#include "neo_ica/backend/channel_kernels.hpp"
+
+template<int NC, class T>
+void test(double tol){
+    typedef neo_ica::backend<T> lapack;
+    using neo_ica::NoTrans;
+    using neo_ica::Trans;
+    int64_t len = 37, ldx = len + 3, ldy = len + 5;
+
+    std::mt19937 gen(NC);
+    std::normal_distribution<double> normal(0, 1);
+    std::vector<T> X(NC*ldx), Y(NC*ldy), A(NC*NC), B(NC*NC), C(NC*NC);
+    for(size_t i = 0 ; i < X.size() ; ++i) X[i] = (T)normal(gen);
+    for(size_t i = 0 ; i < Y.size() ; ++i) Y[i] = (T)normal(gen);
+    for(int i = 0 ; i < NC*NC ; ++i){
+        A[i] = (T)normal(gen);
+        B[i] = (T)normal(gen);
+        C[i] = (T)normal(gen);
+    }
+
+    //Z = X*A, into a chunk with yet another leading dimension
+    std::vector<T> Z(NC*ldy, 0), Zref(NC*ldy, 0);
+    neo_ica::fixed_size::project<NC, T>(len, X.data(), ldx, A.data(), Z.data(), ldy);
+    lapack::gemm(NoTrans,NoTrans,len,NC,NC,1,X.data(),ldx,A.data(),NC,0,Zref.data(),ldy);
+    CHECK(relative_error(NC*ldy, Z.data(), Zref.data()) < tol);
+
+    //R = 0.5*X'*Y + beta*R
+    T betas[] = {0, 2};
+    for(T beta : betas){
+        std::vector<T> R(C), Rref(C);
+        neo_ica::fixed_size::cross<NC, T>(len, 0.5, X.data(), ldx, Y.data(), ldy, beta, R.data());
+        lapack::gemm(Trans,NoTrans,NC,NC,len,0.5,X.data(),ldx,Y.data(),ldy,beta,Rref.data(),NC);
+        CHECK(relative_error(NC*NC, R.data(), Rref.data()) < tol);
+    }
+
+    //C = 2*op(A)*op(B) - C, into a third matrix and in place of A
+    char trans[] = {NoTrans, Trans};
+    for(char ta : trans)
+        for(char tb : trans){
+            std::vector<T> R(C), Rref(C), AR(A);
+            neo_ica::fixed_size::gemm<NC, T>(ta, tb, 2, A.data(), B.data(), -1, R.data());
+            lapack::gemm(ta,tb,NC,NC,NC,2,A.data(),NC,B.data(),NC,-1,Rref.data(),NC);
+            CHECK(relative_error(NC*NC, R.data(), Rref.data()) < tol);
+            neo_ica::fixed_size::gemm<NC, T>(ta, tb, 2, AR.data(), B.data(), 0, AR.data());
+            lapack::gemm(ta,tb,NC,NC,NC,2,A.data(),NC,B.data(),NC,0,Rref.data(),NC);
+            CHECK(relative_error(NC*NC, AR.data(), Rref.data()) < tol);
+        }
+
+    //A random matrix, and one whose leading entries are zero : neither can be factored without pivoting
+    std::vector<T> P(NC*NC, 0);
+    for(int j = 0 ; j < NC ; ++j)
+        for(int i = 0 ; i < NC ; ++i)
+            P[i + j*NC] = (i==(j+1)%NC)?(T)(2 + j):(T)(0.1*normal(gen)*(i!=j));
+    std::vector<T> const * matrices[] = {&A, &P};
+    for(std::vector<T> const * M : matrices){
+        //Inverse and log-determinant, against getrf/getri
+        std::vector<T> LU(*M), Inv(*M);
+        std::vector<typename lapack::size_t> ipiv(NC, 0);
+        lapack::getrf(NC,NC,LU.data(),NC,ipiv.data());
+        double logdet = 0;
+        for(int i = 0 ; i < NC ; ++i)
+            logdet += std::log(std::abs((double)LU[i*(NC+1)]));
+        std::vector<T> Invref(LU);
+        lapack::getri(NC,Invref.data(),NC,ipiv.data());
+        T res = neo_ica::fixed_size::inverse<NC, T>(Inv.data());
+        CHECK(relative_error(NC*NC, Inv.data(), Invref.data()) < tol);
+        CHECK(std::abs(res - logdet) < tol*std::max(1., std::abs(logdet)));
+        CHECK(std::abs(neo_ica::fixed_size::logabsdet<NC, T>(M->data()) - logdet) < tol*std::max(1., std::abs(logdet)));
+
+        //B = inv(M)*B, as in the Cayley transform, against getrf/getrs
+        std::vector<T> Mc(*M), Xs(B), Xref(B);
+        neo_ica::channel_kernels<T>(NC).solve(Mc.data(), Xs.data());
+        lapack::getrs(NoTrans,NC,NC,LU.data(),NC,ipiv.data(),Xref.data(),NC);
+        CHECK(relative_error(NC*NC, Xs.data(), Xref.data()) < tol);
+    }
+}
+
+template<class T>
+void test_all(double tol){
+    test<1, T>(tol);
+    test<2, T>(tol);
+    test<3, T>(tol);
+    test<4, T>(tol);
+    test<5, T>(tol);
+    test<6, T>(tol);
+    test<7, T>(tol);
+    test<8, T>(tol);
+}
+
+int main(){
+    test_all<double>(1e-10);
+    test_all<float>(1e-3);
+    return test_result();
+}
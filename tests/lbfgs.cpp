@@ -0,0 +1,206 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* The ring-buffer L-BFGS direction follows the same iterates as the original implementation (copied below, with the
+ * preconditioner as initial inverse hessian), on a regularized logistic regression */
+
+#include "test-utils.hpp"
+
+#include "neo_ica/backend/backend.hpp"
+#include "umintl/minimize.hpp"
+
+typedef double ScalarType;
+typedef umintl::backend::blas_types<ScalarType> BackendType;
+typedef BackendType::VectorType VectorType;
+
+static const int64_t N = 20;
+static const int64_t NS = 400;
+static const unsigned int iter = 30;
+
+/* The L-BFGS direction before the circular buffer and the fused two-loop recursion */
+struct reference_lbfgs : public umintl::direction<BackendType>{
+    reference_lbfgs(unsigned int _m, bool _use_preconditioner) : m(_m), use_preconditioner(_use_preconditioner), N_(0), q_(), r_(), n_valid_pairs_(0) { }
+    unsigned int m;
+    bool use_preconditioner;
+
+    VectorType & s(size_t i) { return vecs_[i].s; }
+    VectorType & y(size_t i) { return vecs_[i].y; }
+
+    void init(umintl::optimization_context<BackendType> & context){
+        vecs_.resize(m);
+        N_ = context.N();
+        q_ = BackendType::create_vector(N_);
+        r_ = BackendType::create_vector(N_);
+        for(unsigned int i = 0 ; i < m ; ++i){
+            vecs_[i].s = BackendType::create_vector(N_);
+            vecs_[i].y = BackendType::create_vector(N_);
+        }
+        n_valid_pairs_ = 0;
+    }
+
+    void clean(umintl::optimization_context<BackendType> &){
+        BackendType::delete_if_dynamically_allocated(q_);
+        BackendType::delete_if_dynamically_allocated(r_);
+        for(unsigned int i = 0 ; i < m ; ++i){
+            BackendType::delete_if_dynamically_allocated(s(i));
+            BackendType::delete_if_dynamically_allocated(y(i));
+        }
+        vecs_.clear();
+    }
+
+    std::string info() const{ return "Reference low memory quasi-newton"; }
+
+    bool is_scaled() const { return true; }
+
+    void operator()(umintl::optimization_context<BackendType> & c){
+        std::vector<ScalarType> rhos(m);
+        std::vector<ScalarType> alphas(m);
+
+        n_valid_pairs_ = std::min(n_valid_pairs_+1,m);
+        for(unsigned int i = n_valid_pairs_-1 ; i > 0  ; --i){
+            BackendType::copy(N_,s(i-1), s(i));
+            BackendType::copy(N_,y(i-1), y(i));
+        }
+        BackendType::copy(N_,c.x(),s(0));
+        BackendType::axpy(N_,-1,c.xm1(),s(0));
+        BackendType::copy(N_,c.g(),y(0));
+        BackendType::axpy(N_,-1,c.gm1(),y(0));
+
+        BackendType::copy(N_,c.g(),q_);
+        int i = 0;
+        for(; i < (int)n_valid_pairs_ ; ++i){
+            rhos[i] = static_cast<ScalarType>(1)/BackendType::dot(N_,y(i),s(i));
+            alphas[i] = rhos[i]*BackendType::dot(N_,s(i),q_);
+            BackendType::axpy(N_,-alphas[i],y(i),q_);
+        }
+        if(use_preconditioner && c.fun().has_hessian_preconditioner()){
+            umintl::value_gradient tag = c.model().get_value_gradient_tag();
+            c.fun().compute_hessian_preconditioner(c.x(),q_,r_,umintl::hessian_preconditioner(tag.model,tag.sample_size,tag.offset,tag.blocks));
+        }
+        else{
+            ScalarType scale = BackendType::dot(N_,s(0),y(0))/BackendType::dot(N_,y(0),y(0));
+            BackendType::copy(N_,q_,r_);
+            BackendType::scale(N_,scale,r_);
+        }
+        --i;
+        for(; i >=0 ; --i){
+            ScalarType beta = rhos[i]*BackendType::dot(N_,y(i),r_);
+            BackendType::axpy(N_,alphas[i]-beta,s(i),r_);
+        }
+        BackendType::copy(N_,r_,c.p());
+        BackendType::scale(N_,-1,c.p());
+    }
+
+private:
+    struct storage_pair{
+        VectorType s;
+        VectorType y;
+    };
+
+    size_t N_;
+    VectorType q_;
+    VectorType r_;
+    std::vector<storage_pair> vecs_;
+    unsigned int n_valid_pairs_;
+};
+
+/* Never stops : records the iterates */
+struct record_iterates : public umintl::stopping_criterion<BackendType>{
+    record_iterates(std::vector<ScalarType> * _iterates) : iterates(_iterates){ }
+    bool operator()(umintl::optimization_context<BackendType> & c){
+        iterates->insert(iterates->end(), c.x(), c.x() + c.N());
+        return false;
+    }
+    std::vector<ScalarType> * iterates;
+};
+
+/* Logistic regression with a small ridge, and the diagonal of a bound of its hessian as preconditioner */
+class logistic{
+public:
+    logistic(bool has_preconditioner) : has_preconditioner_(has_preconditioner), A_(NS*N), labels_(NS), diag_(N){
+        std::mt19937 gen(1);
+        std::normal_distribution<double> normal(0, 1);
+        std::vector<double> w(N);
+        for(int64_t j = 0 ; j < N ; ++j)
+            w[j] = normal(gen);
+        for(int64_t i = 0 ; i < NS ; ++i){
+            double z = 0;
+            for(int64_t j = 0 ; j < N ; ++j){
+                //Badly scaled features, for the preconditioner to matter
+                A_[i*N + j] = normal(gen)*(1 + j);
+                z += A_[i*N + j]*w[j]/(1 + j);
+            }
+            labels_[i] = (z + normal(gen) > 0)?1:-1;
+        }
+        for(int64_t j = 0 ; j < N ; ++j){
+            diag_[j] = lambda;
+            for(int64_t i = 0 ; i < NS ; ++i)
+                diag_[j] += 0.25*A_[i*N + j]*A_[i*N + j]/NS;
+        }
+    }
+
+    void operator()(VectorType const & x, ScalarType & value, VectorType & grad, umintl::value_gradient) const{
+        value = 0;
+        for(int64_t j = 0 ; j < N ; ++j){
+            value += 0.5*lambda*x[j]*x[j];
+            grad[j] = lambda*x[j];
+        }
+        for(int64_t i = 0 ; i < NS ; ++i){
+            double z = 0;
+            for(int64_t j = 0 ; j < N ; ++j)
+                z += A_[i*N + j]*x[j];
+            double m = labels_[i]*z;
+            value += ((m > 0)?std::log1p(std::exp(-m)):(std::log1p(std::exp(m)) - m))/NS;
+            double d = -labels_[i]/(1 + std::exp(m))/NS;
+            for(int64_t j = 0 ; j < N ; ++j)
+                grad[j] += d*A_[i*N + j];
+        }
+    }
+
+    void operator()(VectorType const &, VectorType const & r, VectorType & z, umintl::hessian_preconditioner) const{
+        for(int64_t j = 0 ; j < N ; ++j)
+            z[j] = has_preconditioner_?r[j]/diag_[j]:r[j];
+    }
+
+private:
+    static constexpr double lambda = 1e-3;
+    bool has_preconditioner_;
+    std::vector<double> A_;
+    std::vector<double> labels_;
+    std::vector<double> diag_;
+};
+
+template<class DirectionType>
+std::vector<ScalarType> iterates(DirectionType const & direction, logistic & fun){
+    std::vector<ScalarType> res;
+    umintl::minimizer<BackendType, DirectionType, umintl::strong_wolfe_powell<BackendType>, record_iterates, umintl::deterministic<BackendType> >
+            minimizer(direction, umintl::strong_wolfe_powell<BackendType>(), record_iterates(&res), umintl::deterministic<BackendType>(), iter);
+    std::vector<ScalarType> x0(N, 0), x(N);
+    VectorType X = x.data(), X0 = x0.data();
+    minimizer(X, fun, X0, N);
+    return res;
+}
+
+int main(){
+    for(int p = 0 ; p < 2 ; ++p){
+        logistic fun(p==1);
+        for(unsigned int m = 1 ; m <= 7 ; m += 3){
+            umintl::low_memory_quasi_newton<BackendType> direction(m);
+            direction.use_preconditioner = (p==1);
+            std::vector<ScalarType> x = iterates(direction, fun);
+            std::vector<ScalarType> ref = iterates(reference_lbfgs(m, p==1), fun);
+            CHECK(x.size()==iter*N);
+            CHECK(x.size()==ref.size());
+            //Rounding differences of the fused recursion grow with the conditioning along the path
+            for(size_t k = 0 ; k < std::min(x.size(),ref.size())/N ; ++k)
+                CHECK(relative_error(N, &x[k*N], &ref[k*N]) < 1e-8);
+        }
+    }
+    return test_result();
+}
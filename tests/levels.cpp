@@ -0,0 +1,75 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* Coarse-to-fine schedule : with three levels, the relative solvers separate the sources as well as with one, as
+ * measured by the Amari index of the unmixing matrix against the mixing matrix */
+
+#include "test-utils.hpp"
+
+typedef double ScalarType;
+static const int64_t NC = 5;
+static const int64_t NF = 40000;
+
+/* Amari index of the K*K row-major P = W*S*A : 0 for a scaled permutation, up to 1 */
+double amari(int64_t K, std::vector<double> const & P){
+    double rows = 0, cols = 0;
+    for(int64_t i = 0 ; i < K ; ++i){
+        double sum = 0, max = 0;
+        for(int64_t j = 0 ; j < K ; ++j){
+            sum += std::abs(P[i*K + j]);
+            max = std::max(max, std::abs(P[i*K + j]));
+        }
+        rows += sum/max - 1;
+    }
+    for(int64_t j = 0 ; j < K ; ++j){
+        double sum = 0, max = 0;
+        for(int64_t i = 0 ; i < K ; ++i){
+            sum += std::abs(P[i*K + j]);
+            max = std::max(max, std::abs(P[i*K + j]));
+        }
+        cols += sum/max - 1;
+    }
+    return (rows + cols)/(2*K*(K - 1));
+}
+
+double separation(std::vector<ScalarType> const & data, std::vector<double> const & A, neo_ica::options const & opt){
+    std::vector<ScalarType> W(NC*NC), S(NC*NC);
+    neo_ica::ica(data.data(), W.data(), S.data(), NC, NF, neo_ica::CHANNEL_MAJOR, opt);
+    std::vector<double> WS(NC*NC, 0), P(NC*NC, 0);
+    for(int64_t i = 0 ; i < NC ; ++i)
+        for(int64_t k = 0 ; k < NC ; ++k)
+            for(int64_t j = 0 ; j < NC ; ++j)
+                WS[i*NC + j] += W[i*NC + k]*S[k*NC + j];
+    for(int64_t i = 0 ; i < NC ; ++i)
+        for(int64_t k = 0 ; k < NC ; ++k)
+            for(int64_t j = 0 ; j < NC ; ++j)
+                P[i*NC + j] += WS[i*NC + k]*A[k*NC + j];
+    return amari(NC, P);
+}
+
+int main(){
+    std::vector<double> A;
+    std::vector<ScalarType> data = mixture<ScalarType>(NC, NC, NF, 2, &A);
+    neo_ica::options opt;
+    opt.tol = 1e-8;
+    //Extended, for the uniform sources
+    opt.extended = true;
+    neo_ica::solver_type solvers[] = {neo_ica::RELATIVE_LBFGS, neo_ica::ORTHOGONAL_LBFGS};
+    for(neo_ica::solver_type solver : solvers){
+        opt.solver = solver;
+        opt.levels = 1;
+        double single = separation(data, A, opt);
+        opt.levels = 3;
+        double multi = separation(data, A, opt);
+        //The noise on the channels keeps the index above 0
+        CHECK(single < 0.02);
+        CHECK(std::abs(multi - single) < 1e-4);
+    }
+    return test_result();
+}
@@ -0,0 +1,61 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* native_lu against LAPACK : factors, inverse, solve and log-determinant, with a leading dimension larger than n */
+
+#include "test-utils.hpp"
+
+#include "neo_ica/backend/backend.hpp"
+#include "neo_ica/backend/lu.hpp"
+
+template<class T>
+void test(int64_t n, double tol){
+    typedef neo_ica::backend<T> lapack;
+    typedef neo_ica::native_lu<T> lu;
+    int64_t lda = n + 3, nrhs = 3;
+
+    std::mt19937 gen(n);
+    std::normal_distribution<double> normal(0, 1);
+    std::vector<T> A(lda*n, 0), B(n*nrhs);
+    for(int64_t j = 0 ; j < n ; ++j)
+        for(int64_t i = 0 ; i < n ; ++i)
+            A[i + j*lda] = (T)normal(gen);
+    for(int64_t i = 0 ; i < n*nrhs ; ++i)
+        B[i] = (T)normal(gen);
+
+    std::vector<T> LUref(A), LU(A), work(n);
+    std::vector<std::ptrdiff_t> ipivref(n), ipiv(n);
+    lapack::getrf(n, n, LUref.data(), lda, ipivref.data());
+    lu::getrf(n, LU.data(), lda, ipiv.data());
+    CHECK(relative_error(lda*n, LU.data(), LUref.data()) < tol);
+
+    //Same log-determinant as the product of the diagonal of LAPACK's factors
+    double logdet = 0;
+    for(int64_t i = 0 ; i < n ; ++i)
+        logdet += std::log(std::abs((double)LUref[i*(lda+1)]));
+    CHECK(std::abs(lu::logabsdet(n, LU.data(), lda) - logdet) < tol*std::max(1., std::abs(logdet)));
+
+    std::vector<T> Xref(B), X(B);
+    lapack::getrs(neo_ica::NoTrans, n, nrhs, LUref.data(), lda, ipivref.data(), Xref.data(), n);
+    lu::getrs(n, nrhs, LU.data(), lda, ipiv.data(), X.data(), n);
+    CHECK(relative_error(n*nrhs, X.data(), Xref.data()) < tol);
+
+    lapack::getri(n, LUref.data(), lda, ipivref.data());
+    lu::getri(n, LU.data(), lda, ipiv.data(), work.data());
+    CHECK(relative_error(lda*n, LU.data(), LUref.data()) < tol);
+}
+
+int main(){
+    int64_t sizes[] = {1, 5, 17, 64};
+    for(int64_t n : sizes){
+        test<double>(n, 1e-10);
+        test<float>(n, 1e-3);
+    }
+    return test_result();
+}
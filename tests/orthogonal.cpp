@@ -0,0 +1,75 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* ORTHOGONAL_LBFGS keeps the weights orthogonal : after ica(), with principal components, with coarse levels, from a
+ * non-orthogonal initial matrix, and through the lockstep ica_batch() */
+
+#include "test-utils.hpp"
+
+typedef double ScalarType;
+static const int64_t NF = 10000;
+
+/* max |W*W' - I| */
+double orthogonality(int64_t K, ScalarType const * W){
+    double res = 0;
+    for(int64_t i = 0 ; i < K ; ++i)
+        for(int64_t j = 0 ; j < K ; ++j){
+            double d = 0;
+            for(int64_t k = 0 ; k < K ; ++k)
+                d += W[i*K + k]*W[j*K + k];
+            res = std::max(res, std::abs(d - (i==j)));
+        }
+    return res;
+}
+
+void test(int64_t NC, int64_t K, neo_ica::options opt){
+    std::vector<ScalarType> data = mixture<ScalarType>(NC, K, NF, NC + K);
+    opt.solver = neo_ica::ORTHOGONAL_LBFGS;
+    opt.pca_components = (K < NC)?K:0;
+    std::vector<ScalarType> W(K*K), S(K*NC);
+    neo_ica::ica(data.data(), W.data(), S.data(), NC, NF, neo_ica::CHANNEL_MAJOR, opt);
+    CHECK(orthogonality(K, W.data()) < 1e-10);
+
+    //From weights far from the orthogonal group
+    std::vector<ScalarType> W0(K*K);
+    for(int64_t i = 0 ; i < K ; ++i)
+        for(int64_t j = 0 ; j < K ; ++j)
+            W0[i*K + j] = (i==j)?1 + i:0.3*(i + 1)/(j + 2);
+    neo_ica::ica(data.data(), W.data(), S.data(), NC, NF, neo_ica::CHANNEL_MAJOR, W0.data(), neo_ica::WHITENED_INIT, opt);
+    CHECK(orthogonality(K, W.data()) < 1e-10);
+}
+
+int main(){
+    neo_ica::options opt;
+    opt.tol = 1e-8;
+    test(4, 4, opt);
+    test(9, 3, opt);
+    opt.levels = 2;
+    test(4, 4, opt);
+    opt.levels = 1;
+    opt.extended = false;
+    test(5, 5, opt);
+
+    //Lockstep
+    opt.extended = true;
+    opt.solver = neo_ica::ORTHOGONAL_LBFGS;
+    const int64_t NC = 3, nproblems = 4;
+    std::vector< std::vector<ScalarType> > data(nproblems), W(nproblems), S(nproblems);
+    std::vector< neo_ica::ica_problem<ScalarType> > problems;
+    for(int64_t k = 0 ; k < nproblems ; ++k){
+        data[k] = mixture<ScalarType>(NC, NC, 2000, k);
+        W[k].resize(NC*NC);
+        S[k].resize(NC*NC);
+        problems.push_back(neo_ica::ica_problem<ScalarType>(data[k].data(), W[k].data(), S[k].data(), NC, 2000));
+    }
+    neo_ica::ica_batch(problems, opt);
+    for(int64_t k = 0 ; k < nproblems ; ++k)
+        CHECK(orthogonality(NC, W[k].data()) < 1e-10);
+    return test_result();
+}
@@ -0,0 +1,63 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* tools::permutation is a bijection that only depends on the seed and on NF, not on the number of threads */
+
+#include "test-utils.hpp"
+
+#include "neo_ica/tools/shuffle.hpp"
+
+#include "omp.h"
+
+static std::vector<size_t> indices(size_t NF, uint64_t seed){
+    std::vector<size_t> res(NF);
+    neo_ica::tools::permutation(NF, seed).indices(res.data());
+    return res;
+}
+
+int main(){
+    //Single element, single bucket, and several chunks and buckets with a partial last one
+    size_t sizes[] = {1, 1000, 300007};
+    for(size_t NF : sizes){
+        std::vector<size_t> perm = indices(NF, 42);
+
+        //Bijection
+        std::vector<char> seen(NF, 0);
+        bool bijection = perm.size()==NF;
+        for(size_t k = 0 ; k < perm.size() ; ++k){
+            bijection &= perm[k] < NF && !seen[perm[k]];
+            if(perm[k] < NF)
+                seen[perm[k]] = 1;
+        }
+        CHECK(bijection);
+
+        //Reproducible, whatever the number of threads
+        CHECK(indices(NF, 42)==perm);
+        int nthreads = omp_get_max_threads();
+        omp_set_num_threads(1);
+        CHECK(indices(NF, 42)==perm);
+        omp_set_num_threads(nthreads);
+
+        //Another seed gives another permutation
+        if(NF > 1)
+            CHECK(indices(NF, 43)!=perm);
+
+        //apply() moves the elements as indices() says, and shuffle() applies the same permutation to all channels
+        std::vector<double> in(2*NF), out(NF);
+        for(size_t i = 0 ; i < 2*NF ; ++i)
+            in[i] = (double)i;
+        neo_ica::tools::permutation(NF, 42).apply(in.data(), out.data());
+        neo_ica::shuffle(in.data(), 2, NF, 42);
+        bool consistent = true;
+        for(size_t k = 0 ; k < NF ; ++k)
+            consistent &= out[k]==(double)perm[k] && in[k]==(double)perm[k] && in[NF + k]==(double)(NF + perm[k]);
+        CHECK(consistent);
+    }
+    return test_result();
+}
@@ -0,0 +1,61 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* Mixed precision : with the whitened data in single precision, ica() and the lockstep ica_batch() find the same
+ * weights as in double precision, up to single precision, with every solver. The sphere is computed from the double
+ * precision data in both cases */
+
+#include "test-utils.hpp"
+
+typedef double ScalarType;
+static const int64_t NC = 4;
+static const int64_t NF = 20000;
+static const int64_t nproblems = 3;
+
+double error(std::vector<ScalarType> const & data, int64_t nc, neo_ica::options opt){
+    std::vector<ScalarType> W(nc*nc), S(nc*nc), Wref(nc*nc), Sref(nc*nc);
+    opt.mixed_precision = false;
+    neo_ica::ica(data.data(), Wref.data(), Sref.data(), nc, NF, neo_ica::CHANNEL_MAJOR, opt);
+    opt.mixed_precision = true;
+    neo_ica::ica(data.data(), W.data(), S.data(), nc, NF, neo_ica::CHANNEL_MAJOR, opt);
+    CHECK(relative_error(nc*nc, S.data(), Sref.data()) < 1e-12);
+    return relative_error(nc*nc, W.data(), Wref.data());
+}
+
+int main(){
+    neo_ica::options opt;
+    opt.tol = 1e-8;
+    std::vector<ScalarType> data = mixture<ScalarType>(NC, NC, NF);
+    neo_ica::solver_type solvers[] = {neo_ica::RELATIVE_LBFGS, neo_ica::ORTHOGONAL_LBFGS, neo_ica::NEWTON_CG};
+    for(neo_ica::solver_type solver : solvers){
+        opt.solver = solver;
+        //The rounding of the data moves the minimum by a few single precision units, times the conditioning of W
+        CHECK(error(data, NC, opt) < 1e-4);
+    }
+
+    //Lockstep batch, against the same problems in double precision
+    opt.solver = neo_ica::RELATIVE_LBFGS;
+    std::vector< std::vector<ScalarType> > datas(nproblems), W(nproblems), S(nproblems), Wref(nproblems), Sref(nproblems);
+    std::vector< neo_ica::ica_problem<ScalarType> > problems, reference;
+    for(int64_t k = 0 ; k < nproblems ; ++k){
+        datas[k] = mixture<ScalarType>(NC, NC, NF, k + 1);
+        W[k].resize(NC*NC); S[k].resize(NC*NC); Wref[k].resize(NC*NC); Sref[k].resize(NC*NC);
+        problems.push_back(neo_ica::ica_problem<ScalarType>(datas[k].data(), W[k].data(), S[k].data(), NC, NF));
+        reference.push_back(neo_ica::ica_problem<ScalarType>(datas[k].data(), Wref[k].data(), Sref[k].data(), NC, NF));
+    }
+    opt.mixed_precision = true;
+    neo_ica::ica_batch(problems, opt);
+    opt.mixed_precision = false;
+    neo_ica::ica_batch(reference, opt);
+    for(int64_t k = 0 ; k < nproblems ; ++k){
+        CHECK(relative_error(NC*NC, W[k].data(), Wref[k].data()) < 1e-4);
+        CHECK(relative_error(NC*NC, S[k].data(), Sref[k].data()) < 1e-12);
+    }
+    return test_result();
+}
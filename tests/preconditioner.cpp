@@ -0,0 +1,163 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* Preconditioning : the linear conjugate gradient solves a badly scaled SPD system with and without a Jacobi
+ * preconditioner, in fewer iterations with it, and in one iteration with the exact inverse. The block solves of the
+ * log-likelihood preconditioners invert the 2x2 blocks of the Hessian approximation, shifted when they are not
+ * positive definite enough */
+
+#include "test-utils.hpp"
+
+#include "neo_ica/backend/backend.hpp"
+#include "neo_ica/tools/hessian.hpp"
+#include "umintl/linear/conjugate_gradient.hpp"
+
+typedef double ScalarType;
+typedef umintl::backend::blas_types<ScalarType> BackendType;
+typedef BackendType::VectorType VectorType;
+typedef umintl::linear::conjugate_gradient<BackendType> cg_type;
+
+static const int64_t N = 40;
+
+/* res = A*b, with A dense and column-major */
+struct dense_product : public umintl::linear::conjugate_gradient_detail::compute_Ab<BackendType>{
+    dense_product(std::vector<ScalarType> const & _A) : A(_A){ }
+    void operator()(size_t n, VectorType const & b, VectorType & res){
+        neo_ica::backend<ScalarType>::gemm(neo_ica::NoTrans,neo_ica::NoTrans,n,1,n,1,A.data(),n,b,n,0,res,n);
+    }
+    std::vector<ScalarType> const & A;
+};
+
+/* res = inv(M)*r, with M either the diagonal of A or A itself */
+struct solve_preconditioner : public umintl::linear::conjugate_gradient_detail::preconditioner<BackendType>{
+    solve_preconditioner(std::vector<ScalarType> const & A, bool exact) : LU(A), ipiv(N, 0), exact_(exact){
+        if(exact_)
+            neo_ica::backend<ScalarType>::getrf(N,N,LU.data(),N,ipiv.data());
+    }
+    void operator()(size_t n, VectorType const & r, VectorType & res){
+        std::copy(r, r + n, res);
+        if(exact_)
+            neo_ica::backend<ScalarType>::getrs(neo_ica::NoTrans,n,1,LU.data(),n,ipiv.data(),res,n);
+        else
+            for(size_t i = 0 ; i < n ; ++i)
+                res[i] /= LU[i*(n+1)];
+    }
+    std::vector<ScalarType> LU;
+    std::vector<neo_ica::backend<ScalarType>::size_t> ipiv;
+    bool exact_;
+};
+
+/* Number of iterations to solve A*x = b, with the given preconditioner (none if NULL) */
+size_t solve(std::vector<ScalarType> const & A, std::vector<ScalarType> const & b, solve_preconditioner * precond){
+    cg_type cg(1000, new dense_product(A), new umintl::linear::conjugate_gradient_detail::residual_norm<BackendType>(1e-10));
+    if(precond)
+        cg.precond.reset(precond);
+    std::vector<ScalarType> x0(N, 0), x(N), Ax(N), rhs(b);
+    VectorType X0 = x0.data(), B = rhs.data(), X = x.data(), AX = Ax.data();
+    cg_type::optimization_result res = cg(N, X0, B, X);
+    CHECK(res.ret==cg_type::SUCCESS);
+    dense_product product(A);
+    product(N, X, AX);
+    CHECK(relative_error(N, Ax.data(), b.data()) < 1e-9);
+    return res.i;
+}
+
+void test_conjugate_gradient(){
+    std::mt19937 gen(3);
+    std::normal_distribution<double> normal(0, 1);
+
+    //A = S*(G*G'/N + I)*S, with scales S over three orders of magnitude
+    std::vector<ScalarType> G(N*N), A(N*N, 0), b(N), s(N);
+    for(int64_t i = 0 ; i < N*N ; ++i)
+        G[i] = normal(gen);
+    for(int64_t i = 0 ; i < N ; ++i){
+        s[i] = std::pow(10., 3.*i/N);
+        b[i] = normal(gen);
+    }
+    for(int64_t j = 0 ; j < N ; ++j)
+        for(int64_t i = 0 ; i < N ; ++i){
+            double gg = (i==j)?1:0;
+            for(int64_t k = 0 ; k < N ; ++k)
+                gg += G[i + k*N]*G[j + k*N]/N;
+            A[i + j*N] = s[i]*gg*s[j];
+        }
+
+    size_t plain = solve(A, b, NULL);
+    size_t jacobi = solve(A, b, new solve_preconditioner(A, false));
+    size_t exact = solve(A, b, new solve_preconditioner(A, true));
+    CHECK(jacobi < plain);
+    CHECK(exact==0);
+}
+
+void test_blocks(){
+    const int64_t NC = 5;
+    const ScalarType lambda_min = 1e-2;
+    std::mt19937 gen(4);
+    std::uniform_real_distribution<double> unif(0, 1);
+    std::normal_distribution<double> normal(0, 1);
+
+    //Super-gaussian moments, whose blocks are positive definite, then sub-gaussian ones, whose blocks need a shift
+    for(int shifted = 0 ; shifted < 2 ; ++shifted){
+        std::vector<ScalarType> dphi(NC), zsq(NC), zphi(NC), R(NC*NC), D(NC*NC);
+        for(int64_t i = 0 ; i < NC ; ++i){
+            dphi[i] = shifted?0.1*unif(gen):1.5 + unif(gen);
+            zsq[i] = 0.8 + 0.4*unif(gen);
+            zphi[i] = 0.5*unif(gen);
+        }
+        for(int64_t i = 0 ; i < NC*NC ; ++i)
+            R[i] = normal(gen);
+        neo_ica::solve_hessian_blocks(NC, dphi.data(), zsq.data(), R.data(), D.data());
+
+        //[a 1; 1 b]*(D_ij, D_ji) = (R_ij, R_ji), with a and b shifted by the same amount so that the smallest
+        //eigenvalue of the block is lambda_min
+        bool solved = true;
+        for(int64_t i = 0 ; i < NC ; ++i){
+            double hii = std::max<double>(dphi[i]*zsq[i] + 1, lambda_min);
+            solved &= std::abs(hii*D[i*(NC+1)] - R[i*(NC+1)]) < 1e-12;
+            for(int64_t j = i + 1 ; j < NC ; ++j){
+                double a = dphi[j]*zsq[i], b = dphi[i]*zsq[j];
+                double eigmin = (a + b - std::sqrt((a-b)*(a-b) + 4))/2;
+                CHECK((eigmin < lambda_min)==(shifted==1));
+                double shift = std::max(0., lambda_min - eigmin);
+                a += shift;
+                b += shift;
+                double dij = D[i + j*NC], dji = D[j + i*NC];
+                solved &= std::abs(a*dij + dji - R[i + j*NC]) < 1e-10*std::max(1., std::abs(R[i + j*NC]));
+                solved &= std::abs(dij + b*dji - R[j + i*NC]) < 1e-10*std::max(1., std::abs(R[j + i*NC]));
+                //Descent direction for -R
+                solved &= dij*R[i + j*NC] + dji*R[j + i*NC] > 0;
+            }
+        }
+        CHECK(solved);
+
+        //Skew-symmetric R : k_ij*D_ij = 2*R_ij, with k_ij the curvature of the pair, and D skew-symmetric
+        for(int64_t i = 0 ; i < NC ; ++i)
+            for(int64_t j = i ; j < NC ; ++j){
+                R[i + j*NC] = (i==j)?0:R[i + j*NC];
+                R[j + i*NC] = -R[i + j*NC];
+            }
+        neo_ica::solve_skew_hessian_blocks(NC, dphi.data(), zsq.data(), zphi.data(), R.data(), D.data());
+        bool skew = true;
+        for(int64_t i = 0 ; i < NC ; ++i){
+            skew &= D[i*(NC+1)]==0;
+            for(int64_t j = i + 1 ; j < NC ; ++j){
+                double k = std::max<double>(dphi[j]*zsq[i] + dphi[i]*zsq[j] - zphi[i] - zphi[j], lambda_min);
+                skew &= D[j + i*NC]==-D[i + j*NC];
+                skew &= std::abs(k*D[i + j*NC] - 2*R[i + j*NC]) < 1e-10*std::max(1., std::abs(R[i + j*NC]));
+            }
+        }
+        CHECK(skew);
+    }
+}
+
+int main(){
+    test_conjugate_gradient();
+    test_blocks();
+    return test_result();
+}
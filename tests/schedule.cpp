@@ -0,0 +1,74 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* Block schedules of the dynamically sampled model : the blocks are visited in a random order, the points after the
+ * last full block form a short final block, and a full batch uses all the points. A subset only keeps whole blocks,
+ * and the short one only when it keeps all the full ones */
+
+#include "test-utils.hpp"
+
+#include <algorithm>
+
+#include "neo_ica/backend/backend.hpp"
+#include "umintl/model_base.hpp"
+
+typedef umintl::backend::blas_types<double> BackendType;
+typedef umintl::dynamically_sampled<BackendType> model_type;
+
+static const size_t block = 100;
+
+/* Each of the nblocks blocks of the dataset is scheduled once */
+bool covers(umintl::block_schedule const & s, size_t nblocks){
+    std::vector<size_t> order(s.order);
+    std::sort(order.begin(), order.end());
+    bool res = order.size()==nblocks;
+    for(size_t k = 0 ; k < order.size() ; ++k)
+        res &= order[k]==k;
+    return res;
+}
+
+void test(size_t NF){
+    size_t nfull = NF/block, tail = NF%block;
+
+    //Full batch
+    model_type full(0.1, NF, NF, 0.5, block);
+    umintl::value_gradient tag = full.get_value_gradient_tag();
+    CHECK(tag.blocks!=NULL);
+    CHECK(tag.sample_size==NF);
+    CHECK(tag.blocks->size()==NF);
+    CHECK(covers(*tag.blocks, nfull + (tail>0)));
+    if(tail > 0)
+        CHECK(tag.blocks->order.back()==nfull);
+    //Not in increasing order
+    CHECK(!std::is_sorted(tag.blocks->order.begin(), tag.blocks->order.end()));
+
+    //Smaller batch, from the same schedule
+    model_type small(0.1, NF/4, NF, 0.5, block);
+    tag = small.get_value_gradient_tag();
+    CHECK(tag.sample_size==NF/4);
+    CHECK(tag.blocks->size()==NF);
+
+    //Subsets : whole blocks only, then everything
+    model_type part(0.1, NF, NF, 0.5, block, NF/2);
+    tag = part.get_value_gradient_tag();
+    CHECK(tag.sample_size==(NF/2)/block*block);
+    CHECK(tag.blocks->size()==tag.sample_size);
+    CHECK(tag.blocks->order.size()==(NF/2)/block);
+    model_type all(0.1, NF, NF, 0.5, block, NF);
+    tag = all.get_value_gradient_tag();
+    CHECK(tag.sample_size==NF);
+    CHECK(covers(*tag.blocks, nfull + (tail>0)));
+}
+
+int main(){
+    test(2000);
+    test(2037);
+    test(2099);
+    return test_result();
+}
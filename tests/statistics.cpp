@@ -0,0 +1,158 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* channel_statistics against a two-pass reference, in both layouts, in chunks merged across accumulators, and with
+ * a large offset on the data removed by the shift. The means and covariance of compute_moments against a two-pass
+ * reference too, on correlated channels around a much larger offset */
+
+#include "test-utils.hpp"
+
+#include "neo_ica/tools/statistics.hpp"
+#include "neo_ica/tools/whiten.hpp"
+
+static const int64_t NC = 5;
+static const int64_t NF = 10007;
+
+struct moments{
+    double mean, variance, skewness, kurtosis;
+};
+
+/* Mean first, then the central moments around it */
+template<class T>
+moments two_pass(T const * x, T shift){
+    moments res;
+    double m = 0, m2 = 0, m3 = 0, m4 = 0;
+    for(int64_t f = 0 ; f < NF ; ++f)
+        m += (double)x[f];
+    m /= NF;
+    for(int64_t f = 0 ; f < NF ; ++f){
+        double d = (double)x[f] - m;
+        m2 += d*d;
+        m3 += d*d*d;
+        m4 += d*d*d*d;
+    }
+    m2 /= NF; m3 /= NF; m4 /= NF;
+    res.mean = m - (double)shift;
+    res.variance = m2*NF/(NF - 1);
+    res.skewness = m3/std::pow(m2, 1.5);
+    res.kurtosis = m4/(m2*m2) - 3;
+    return res;
+}
+
+static bool close(double x, double y, double tol){
+    return std::abs(x - y) <= tol*std::max(1., std::abs(y));
+}
+
+template<class T>
+void test(double tol){
+    //Channels with different shapes around a large offset
+    std::mt19937 gen(3);
+    std::exponential_distribution<double> expo(1);
+    std::uniform_real_distribution<double> unif(-1, 1);
+    std::vector<T> X(NC*NF);
+    for(int64_t c = 0 ; c < NC ; ++c)
+        for(int64_t f = 0 ; f < NF ; ++f)
+            X[c*NF + f] = (T)(1000 + c + (c+1)*((c%2)?unif(gen):expo(gen)));
+    std::vector<T> samples = transpose(X, NC, NF);
+    std::vector<T> shift(NC);
+    for(int64_t c = 0 ; c < NC ; ++c)
+        shift[c] = X[c*NF];
+
+    //Whole channels ; uneven chunks merged from two accumulators ; sample-major
+    neo_ica::tools::channel_statistics<T> whole(NC), first(NC), second(NC), rows(NC), order2(NC, 2);
+    whole.accumulate(NF, X.data(), NF, shift.data());
+    int64_t split = 3001;
+    first.accumulate(split, X.data(), NF, shift.data());
+    second.accumulate(NF - split, X.data() + split, NF, shift.data());
+    first.merge(second);
+    rows.accumulate_samples(NF, samples.data(), NC, shift.data());
+    order2.accumulate(NF, X.data(), NF, shift.data());
+
+    neo_ica::tools::channel_statistics<T> const * stats[] = {&whole, &first, &rows};
+    for(neo_ica::tools::channel_statistics<T> const * s : stats){
+        CHECK(s->count()==NF);
+        for(int64_t c = 0 ; c < NC ; ++c){
+            moments ref = two_pass(X.data() + c*NF, shift[c]);
+            CHECK(close(s->mean(c), ref.mean, tol));
+            CHECK(close(s->variance(c), ref.variance, tol));
+            CHECK(close(s->skewness(c), ref.skewness, tol));
+            CHECK(close(s->kurtosis(c), ref.kurtosis, tol));
+        }
+    }
+    for(int64_t c = 0 ; c < NC ; ++c){
+        moments ref = two_pass(X.data() + c*NF, shift[c]);
+        CHECK(close(order2.mean(c), ref.mean, tol));
+        CHECK(close(order2.variance(c), ref.variance, tol));
+    }
+}
+
+/* Means and covariance of the first nf samples of the channel-major X, mean first, then the products around it */
+template<class T>
+void two_pass_moments(int64_t nf, std::vector<T> const & X, std::vector<double> & means, std::vector<double> & Cov){
+    for(int64_t c = 0 ; c < NC ; ++c){
+        means[c] = 0;
+        for(int64_t f = 0 ; f < nf ; ++f)
+            means[c] += (double)X[c*NF + f];
+        means[c] /= nf;
+    }
+    for(int64_t i = 0 ; i < NC ; ++i)
+        for(int64_t j = 0 ; j < NC ; ++j){
+            double cij = 0;
+            for(int64_t f = 0 ; f < nf ; ++f)
+                cij += ((double)X[i*NF + f] - means[i])*((double)X[j*NF + f] - means[j]);
+            Cov[i + j*NC] = cij/(nf - 1);
+        }
+}
+
+template<class T>
+void test_moments(double tol){
+    //Unit-scale mixtures of uniform sources, around 1e6 : a one-pass sum of squares loses every digit
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<double> unif(-1, 1);
+    std::vector<double> S(NC*NF);
+    for(int64_t i = 0 ; i < NC*NF ; ++i)
+        S[i] = unif(gen);
+    std::vector<T> X(NC*NF);
+    for(int64_t c = 0 ; c < NC ; ++c)
+        for(int64_t f = 0 ; f < NF ; ++f){
+            double x = 1e6*(1 + c);
+            for(int64_t k = 0 ; k <= c ; ++k)
+                x += (k + 1)*S[k*NF + f];
+            X[c*NF + f] = (T)x;
+        }
+    std::vector<T> samples = transpose(X, NC, NF);
+
+    //Several blocks, then the first samples only
+    int64_t nfs[] = {NF, 1500};
+    for(int64_t nf : nfs){
+        std::vector<double> means(NC), Cov(NC*NC);
+        two_pass_moments(nf, X, means, Cov);
+        neo_ica::layout_type layouts[] = {neo_ica::CHANNEL_MAJOR, neo_ica::SAMPLE_MAJOR};
+        for(neo_ica::layout_type layout : layouts){
+            std::vector<T> m(NC), C(NC*NC);
+            T const * data = (layout==neo_ica::CHANNEL_MAJOR)?X.data():samples.data();
+            neo_ica::compute_moments(NC, NF, nf, data, m.data(), C.data(), layout);
+            bool exact = true;
+            for(int64_t i = 0 ; i < NC ; ++i){
+                exact &= close(m[i], means[i], tol);
+                for(int64_t j = 0 ; j < NC ; ++j)
+                    exact &= std::abs(C[i + j*NC] - Cov[i + j*NC]) <= tol*std::sqrt(Cov[i*(NC+1)]*Cov[j*(NC+1)]);
+            }
+            CHECK(exact);
+        }
+    }
+}
+
+int main(){
+    test<double>(1e-10);
+    test<float>(1e-3);
+    test_moments<double>(1e-10);
+    test_moments<float>(1e-3);
+    return test_result();
+}
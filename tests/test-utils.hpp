@@ -0,0 +1,93 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+#ifndef NEO_ICA_TESTS_TEST_UTILS_HPP_
+#define NEO_ICA_TESTS_TEST_UTILS_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "neo_ica/ica.h"
+
+/* Reports a failed check, and makes the test return EXIT_FAILURE */
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+inline int & failures(){
+    static int res = 0;
+    return res;
+}
+
+inline void check(bool cond, char const * expr, char const * file, int line){
+    if(!cond){
+        std::cerr << file << ":" << line << ": check failed : " << expr << std::endl;
+        ++failures();
+    }
+}
+
+inline int test_result(){
+    if(failures())
+        std::cerr << failures() << " check(s) failed" << std::endl;
+    return failures()?EXIT_FAILURE:EXIT_SUCCESS;
+}
+
+/* max_i |x[i] - y[i]| / max(1, max_i |y[i]|) */
+template<class T>
+double relative_error(int64_t n, T const * x, T const * y){
+    double err = 0, nrm = 1;
+    for(int64_t i = 0 ; i < n ; ++i){
+        err = std::max(err, std::abs((double)x[i] - (double)y[i]));
+        nrm = std::max(nrm, std::abs((double)y[i]));
+    }
+    return err/nrm;
+}
+
+/* NC*NF channel-major mixture of K < NC Laplacian and uniform sources, with a little noise on every channel so that
+ * the covariance has full rank. The row-major NC*K mixing matrix goes to mixing, if not NULL */
+template<class T>
+std::vector<T> mixture(int64_t NC, int64_t K, int64_t NF, unsigned int seed = 0, std::vector<double> * mixing = NULL){
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> unif(-1, 1);
+    std::exponential_distribution<double> expo(1);
+    std::normal_distribution<double> noise(0, 0.01);
+    std::vector<double> A(NC*K);
+    for(int64_t i = 0 ; i < NC*K ; ++i)
+        A[i] = unif(gen);
+    if(mixing)
+        *mixing = A;
+    std::vector<T> res(NC*NF);
+    std::vector<double> s(K);
+    for(int64_t f = 0 ; f < NF ; ++f){
+        for(int64_t k = 0 ; k < K ; ++k)
+            s[k] = (k%2)?unif(gen):((unif(gen) > 0)?expo(gen):-expo(gen));
+        for(int64_t c = 0 ; c < NC ; ++c){
+            double x = noise(gen);
+            for(int64_t k = 0 ; k < K ; ++k)
+                x += A[c*K + k]*s[k];
+            res[c*NF + f] = (T)x;
+        }
+    }
+    return res;
+}
+
+/* Sample-major copy of the NC*NF channel-major data */
+template<class T>
+std::vector<T> transpose(std::vector<T> const & data, int64_t NC, int64_t NF){
+    std::vector<T> res(NC*NF);
+    for(int64_t c = 0 ; c < NC ; ++c)
+        for(int64_t f = 0 ; f < NF ; ++f)
+            res[f*NC + c] = data[c*NF + f];
+    return res;
+}
+
+#endif
@@ -0,0 +1,140 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* Objective updates in the minimizer : when the objective reports a change after an iteration, the value and gradient
+ * are recomputed on the new objective, the direction is reset, the stopping criterion is skipped for that iteration,
+ * and the next step is a steepest descent one. The iterates then converge to the minimum of the new objective */
+
+#include "test-utils.hpp"
+
+#include "neo_ica/backend/backend.hpp"
+#include "umintl/minimize.hpp"
+
+typedef double ScalarType;
+typedef umintl::backend::blas_types<ScalarType> BackendType;
+typedef BackendType::VectorType VectorType;
+
+static const int64_t N = 10;
+static const unsigned int iter = 40;
+static const unsigned int update_iteration = 2;
+
+/* 0.5*sum_j d_j*(x_j - t_j)^2, whose target t moves at the end of iteration update_iteration */
+class moving_quadratic{
+public:
+    moving_quadratic() : updates(0), target_(N){
+        for(int64_t j = 0 ; j < N ; ++j)
+            target_[j] = 1;
+    }
+
+    ScalarType value(ScalarType const * x, ScalarType * grad) const{
+        ScalarType res = 0;
+        for(int64_t j = 0 ; j < N ; ++j){
+            ScalarType d = (1 + j)*(x[j] - target_[j]);
+            res += 0.5*d*(x[j] - target_[j]);
+            if(grad)
+                grad[j] = d;
+        }
+        return res;
+    }
+
+    void operator()(VectorType const & x, ScalarType & val, VectorType & grad, umintl::value_gradient) const{
+        val = value(x, grad);
+    }
+
+    //Called once per iteration, after the line search
+    bool operator()(VectorType const &, umintl::objective_update){
+        if(updates++ != update_iteration)
+            return false;
+        for(int64_t j = 0 ; j < N ; ++j)
+            target_[j] = -2 + 0.5*j;
+        return true;
+    }
+
+    ScalarType target(int64_t j) const { return target_[j]; }
+
+    unsigned int updates;
+
+private:
+    std::vector<ScalarType> target_;
+};
+
+/* L-BFGS that records its iterations and resets */
+struct recording_lbfgs : public umintl::low_memory_quasi_newton<BackendType>{
+    recording_lbfgs(std::vector<unsigned int> * _iterations, unsigned int * _resets) : umintl::low_memory_quasi_newton<BackendType>(5), iterations(_iterations), resets(_resets){ }
+
+    void operator()(umintl::optimization_context<BackendType> & c){
+        iterations->push_back(c.iter());
+        umintl::low_memory_quasi_newton<BackendType>::operator()(c);
+    }
+
+    void reset(umintl::optimization_context<BackendType> & c){
+        ++*resets;
+        umintl::low_memory_quasi_newton<BackendType>::reset(c);
+    }
+
+    std::vector<unsigned int> * iterations;
+    unsigned int * resets;
+};
+
+/* Never stops : records its iterations and, right after the update, the step and the state it started from */
+struct recording_stop : public umintl::stopping_criterion<BackendType>{
+    recording_stop(moving_quadratic const * _fun, std::vector<unsigned int> * _iterations) : fun(_fun), iterations(_iterations){ }
+
+    bool operator()(umintl::optimization_context<BackendType> & c){
+        iterations->push_back(c.iter());
+        if(c.iter()==update_iteration + 1){
+            //Value and gradient of the new objective at the previous iterate, and p = -g
+            std::vector<ScalarType> g(N), p(N);
+            ScalarType val = fun->value(c.xm1(), g.data());
+            CHECK(std::abs(c.valm1() - val) <= 1e-12*std::abs(val));
+            CHECK(relative_error(N, c.gm1(), g.data()) == 0);
+            for(int64_t j = 0 ; j < N ; ++j)
+                p[j] = -g[j];
+            CHECK(relative_error(N, c.p(), p.data()) == 0);
+        }
+        return false;
+    }
+
+    moving_quadratic const * fun;
+    std::vector<unsigned int> * iterations;
+};
+
+int main(){
+    moving_quadratic fun;
+    std::vector<unsigned int> directions, stops;
+    unsigned int resets = 0;
+    umintl::minimizer<BackendType, recording_lbfgs, umintl::strong_wolfe_powell<BackendType>, recording_stop, umintl::deterministic<BackendType> >
+            minimizer(recording_lbfgs(&directions, &resets), umintl::strong_wolfe_powell<BackendType>(), recording_stop(&fun, &stops)
+                      , umintl::deterministic<BackendType>(), iter);
+    std::vector<ScalarType> x0(N, 0), x(N);
+    VectorType X = x.data(), X0 = x0.data();
+    minimizer(X, fun, X0, N);
+
+    CHECK(fun.updates==iter);
+    CHECK(resets==1);
+    //As on the first iteration, the direction is skipped right after the update for a steepest descent step, and used
+    //again afterwards
+    bool skipped = true;
+    for(unsigned int k : directions)
+        skipped &= k!=0 && k!=update_iteration + 1;
+    CHECK(skipped);
+    CHECK(directions.size()==iter - 2);
+    //No stopping test at the update
+    CHECK(stops.size()==iter - 1);
+    bool tested = true;
+    for(unsigned int k : stops)
+        tested &= k!=update_iteration;
+    CHECK(tested);
+
+    std::vector<ScalarType> target(N);
+    for(int64_t j = 0 ; j < N ; ++j)
+        target[j] = fun.target(j);
+    CHECK(relative_error(N, x.data(), target.data()) < 1e-8);
+    return test_result();
+}
@@ -0,0 +1,55 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* Warm starts : refitted from its own solution, given either as the unmixing matrix W*S of the centered data or as the
+ * whitened weights W, each solver stays at the same weights within a few iterations, with and without principal
+ * components. From the identity, the same few iterations are not enough */
+
+#include "test-utils.hpp"
+
+typedef double ScalarType;
+static const int64_t NF = 20000;
+static const size_t few = 3;
+
+void test(int64_t NC, int64_t K, neo_ica::solver_type solver){
+    std::vector<ScalarType> data = mixture<ScalarType>(NC, K, NF, NC + K);
+    neo_ica::options opt;
+    opt.solver = solver;
+    opt.tol = 1e-8;
+    opt.pca_components = (K < NC)?K:0;
+    //NEWTON_CG on the whole data from the start : on its growing samples, it may stop before the minimum of the whole
+    //data, which a warm start would then move towards
+    opt.fbatch = NF;
+
+    std::vector<ScalarType> W(K*K), S(K*NC), U(K*NC, 0);
+    neo_ica::ica(data.data(), W.data(), S.data(), NC, NF, neo_ica::CHANNEL_MAJOR, opt);
+    for(int64_t i = 0 ; i < K ; ++i)
+        for(int64_t k = 0 ; k < K ; ++k)
+            for(int64_t j = 0 ; j < NC ; ++j)
+                U[i*NC + j] += W[i*K + k]*S[k*NC + j];
+
+    opt.iter = few;
+    std::vector<ScalarType> Wr(K*K), Sr(K*NC), Ww(K*K), Sw(K*NC), Wi(K*K), Si(K*NC);
+    neo_ica::ica(data.data(), Wr.data(), Sr.data(), NC, NF, neo_ica::CHANNEL_MAJOR, U.data(), neo_ica::RAW_INIT, opt);
+    neo_ica::ica(data.data(), Ww.data(), Sw.data(), NC, NF, neo_ica::CHANNEL_MAJOR, W.data(), neo_ica::WHITENED_INIT, opt);
+    neo_ica::ica(data.data(), Wi.data(), Si.data(), NC, NF, neo_ica::CHANNEL_MAJOR, opt);
+    CHECK(relative_error(K*NC, Sr.data(), S.data()) == 0);
+    CHECK(relative_error(K*K, Wr.data(), W.data()) < 1e-5);
+    CHECK(relative_error(K*K, Ww.data(), W.data()) < 1e-5);
+    CHECK(relative_error(K*K, Wi.data(), W.data()) > 1e-2);
+}
+
+int main(){
+    neo_ica::solver_type solvers[] = {neo_ica::RELATIVE_LBFGS, neo_ica::ORTHOGONAL_LBFGS, neo_ica::NEWTON_CG};
+    for(neo_ica::solver_type solver : solvers){
+        test(4, 4, solver);
+        test(8, 3, solver);
+    }
+    return test_result();
+}
@@ -0,0 +1,152 @@
+/* ===========================
+ *
+ * Copyright (c) 2013 Philippe Tillet - National Chiao Tung University
+ *
+ * NEO-ICA - Dynamically Sampled Hessian Free Independent Comopnent Analaysis
+ *
+ * License : MIT X11 - See the LICENSE file in the root folder
+ * ===========================*/
+
+/* Whitening with fewer principal components than channels, in both layouts : the whitened data only holds K channels,
+ * and both layouts give the same weights and sphere. With many channels, the randomized range finder spans the same
+ * leading subspace as the exact principal components, and whitens the data. The eigensolvers behind the sphere and the
+ * principal components, syev, syevd and syevr, give the same eigenpairs */
+
+#include "test-utils.hpp"
+
+#include "neo_ica/tools/whiten.hpp"
+
+typedef double ScalarType;
+static const int64_t NC = 16;
+static const int64_t K = 4;
+static const int64_t NF = 20000;
+
+/* Enough channels for compute_pca to take the randomized path : 16*(K + 10) <= NC */
+void test_randomized_pca(){
+    const int64_t NC = 200, K = 2, NF = 5000;
+    std::vector<ScalarType> data = mixture<ScalarType>(NC, K, NF, 3);
+    std::vector<ScalarType> samples = transpose(data, NC, NF);
+
+    //Exact projection, from the full covariance
+    std::vector<ScalarType> P(NC*K), means(NC), Cov(NC*NC);
+    neo_ica::compute_moments(NC, NF, NF, data.data(), means.data(), Cov.data());
+    neo_ica::detail::inv_sqrt_pca<ScalarType>(NC, K, Cov.data(), P.data());
+
+    std::vector<ScalarType> Pr[2], meansr(NC);
+    neo_ica::layout_type layouts[] = {neo_ica::CHANNEL_MAJOR, neo_ica::SAMPLE_MAJOR};
+    for(int l = 0 ; l < 2 ; ++l){
+        ScalarType const * X = (layouts[l]==neo_ica::CHANNEL_MAJOR)?data.data():samples.data();
+        Pr[l].resize(NC*K);
+        neo_ica::compute_pca(NC, NF, NF, K, X, Pr[l].data(), meansr.data(), layouts[l]);
+        CHECK(relative_error(NC, meansr.data(), means.data()) < 1e-12);
+
+        //Same span : the projection of each normalized randomized direction onto the normalized exact ones is a unit
+        //vector. The directions themselves may differ in sign
+        std::vector<ScalarType> U(P), Ur(Pr[l]);
+        for(int64_t j = 0 ; j < K ; ++j){
+            double n = 0, nr = 0;
+            for(int64_t i = 0 ; i < NC ; ++i){
+                n += U[j*NC+i]*U[j*NC+i];
+                nr += Ur[j*NC+i]*Ur[j*NC+i];
+            }
+            for(int64_t i = 0 ; i < NC ; ++i){
+                U[j*NC+i] /= std::sqrt(n);
+                Ur[j*NC+i] /= std::sqrt(nr);
+            }
+        }
+        for(int64_t j = 0 ; j < K ; ++j){
+            double norm = 0;
+            for(int64_t k = 0 ; k < K ; ++k){
+                double d = 0;
+                for(int64_t i = 0 ; i < NC ; ++i)
+                    d += U[k*NC+i]*Ur[j*NC+i];
+                norm += d*d;
+            }
+            CHECK(std::abs(norm - 1) < 1e-6);
+        }
+
+        //Unit covariance of the whitened data
+        std::vector<ScalarType> white(K*NF);
+        neo_ica::apply_sphere(NC, K, NF, NF, X, meansr.data(), Pr[l].data(), (neo_ica::tools::permutation const *)NULL, white.data(), layouts[l]);
+        for(int64_t i = 0 ; i < K ; ++i)
+            for(int64_t j = 0 ; j < K ; ++j){
+                double cov = 0;
+                for(int64_t f = 0 ; f < NF ; ++f)
+                    cov += white[i*NF + f]*white[j*NF + f];
+                CHECK(std::abs(cov/(NF-1) - (i==j)) < 1e-8);
+            }
+    }
+    CHECK(relative_error(NC*K, Pr[1].data(), Pr[0].data()) < 1e-10);
+}
+
+/* |u'v| = 1 for each pair of unit columns of U and V, which may differ in sign */
+bool same_vectors(int64_t n, int64_t K, ScalarType const * U, ScalarType const * V){
+    bool res = true;
+    for(int64_t j = 0 ; j < K ; ++j){
+        double d = 0;
+        for(int64_t i = 0 ; i < n ; ++i)
+            d += U[j*n+i]*V[j*n+i];
+        res &= std::abs(std::abs(d) - 1) < 1e-8;
+    }
+    return res;
+}
+
+void test_eigensolvers(){
+    std::mt19937 gen(7);
+    std::normal_distribution<double> normal(0, 1);
+    //syev below the divide and conquer threshold, syevd above
+    int64_t sizes[] = {20, 100};
+    for(int64_t n : sizes){
+        //Covariance-like : G*G'/n + I
+        std::vector<ScalarType> G(n*n), A(n*n);
+        for(int64_t i = 0 ; i < n*n ; ++i)
+            G[i] = normal(gen);
+        for(int64_t j = 0 ; j < n ; ++j)
+            for(int64_t i = 0 ; i < n ; ++i){
+                double aij = (i==j)?1:0;
+                for(int64_t k = 0 ; k < n ; ++k)
+                    aij += G[i + k*n]*G[j + k*n]/n;
+                A[i + j*n] = aij;
+            }
+
+        //Reference : syev, whatever the size
+        std::vector<ScalarType> Uref(A), wref(n);
+        neo_ica::backend<ScalarType>::syev('V','U',n,Uref.data(),n,wref.data());
+
+        std::vector<ScalarType> U(A), w(n);
+        neo_ica::detail::eigensolver<ScalarType>()(n, U.data(), w.data());
+        CHECK(relative_error(n, w.data(), wref.data()) < 1e-12);
+        CHECK(same_vectors(n, n, U.data(), Uref.data()));
+
+        //syevr, on the largest eigenpairs and on all of them
+        int64_t Ks[] = {n/4, n};
+        for(int64_t K : Ks){
+            std::vector<ScalarType> B(A), Z(n*K), wr(K);
+            neo_ica::detail::eigensolver<ScalarType>().largest(n, K, B.data(), wr.data(), Z.data());
+            CHECK(relative_error(K, wr.data(), wref.data() + n - K) < 1e-12);
+            CHECK(same_vectors(n, K, Z.data(), Uref.data() + (n - K)*n));
+        }
+    }
+}
+
+int main(){
+    test_randomized_pca();
+    test_eigensolvers();
+
+    std::vector<ScalarType> data = mixture<ScalarType>(NC, K, NF);
+    std::vector<ScalarType> samples = transpose(data, NC, NF);
+
+    neo_ica::options opt;
+    opt.pca_components = K;
+
+    neo_ica::solver_type solvers[] = {neo_ica::RELATIVE_LBFGS, neo_ica::NEWTON_CG};
+    for(int s = 0 ; s < 2 ; ++s){
+        opt.solver = solvers[s];
+        std::vector<ScalarType> W(K*K), S(K*NC), Wt(K*K), St(K*NC);
+        neo_ica::ica(data.data(), W.data(), S.data(), NC, NF, neo_ica::CHANNEL_MAJOR, opt);
+        neo_ica::ica(samples.data(), Wt.data(), St.data(), NC, NF, neo_ica::SAMPLE_MAJOR, opt);
+        CHECK(relative_error(K*NC, St.data(), S.data()) < 1e-10);
+        CHECK(relative_error(K*K, Wt.data(), W.data()) < 1e-6);
+    }
+    return test_result();
+}